@@ -0,0 +1,58 @@
+# Provides the ZLIB::ZLIB target for the format code.
+#
+# macOS, iOS, Android and Linux all ship zlib with the platform, so the system
+# copy is used there. Windows doesn't, and whatever find_package turns up on a
+# build machine (Strawberry Perl, MinGW, ...) may not be ABI compatible, so
+# zlib is built from source instead
+if (TARGET ZLIB::ZLIB)
+    return()
+endif()
+
+if (WIN32)
+    set(GMDAPI_DEFAULT_SYSTEM_ZLIB OFF)
+else()
+    set(GMDAPI_DEFAULT_SYSTEM_ZLIB ON)
+endif()
+option(GMDAPI_SYSTEM_ZLIB "Use the platform's zlib instead of building it" ${GMDAPI_DEFAULT_SYSTEM_ZLIB})
+
+if (GMDAPI_SYSTEM_ZLIB)
+    find_package(ZLIB QUIET)
+endif()
+
+if (NOT ZLIB_FOUND)
+    message(STATUS "GMD-API: building zlib from source")
+
+    include(FetchContent)
+    FetchContent_Declare(gmdapi_zlib
+        URL https://github.com/madler/zlib/releases/download/v1.3.1/zlib-1.3.1.tar.gz
+        URL_HASH SHA256=9a93b2b7dfdac77ceba5a558a580e74667dd6fede4585b91eefb60f03b72df23
+        # only the sources are needed; zlib's own CMakeLists builds a shared 
+        # library and installs things, so don't add it
+        SOURCE_SUBDIR _none
+    )
+    FetchContent_MakeAvailable(gmdapi_zlib)
+
+    enable_language(C)
+    # the gz* file functions aren't used
+    add_library(gmdapi-zlib STATIC
+        ${gmdapi_zlib_SOURCE_DIR}/adler32.c
+        ${gmdapi_zlib_SOURCE_DIR}/compress.c
+        ${gmdapi_zlib_SOURCE_DIR}/crc32.c
+        ${gmdapi_zlib_SOURCE_DIR}/deflate.c
+        ${gmdapi_zlib_SOURCE_DIR}/infback.c
+        ${gmdapi_zlib_SOURCE_DIR}/inffast.c
+        ${gmdapi_zlib_SOURCE_DIR}/inflate.c
+        ${gmdapi_zlib_SOURCE_DIR}/inftrees.c
+        ${gmdapi_zlib_SOURCE_DIR}/trees.c
+        ${gmdapi_zlib_SOURCE_DIR}/uncompr.c
+        ${gmdapi_zlib_SOURCE_DIR}/zutil.c
+    )
+    target_include_directories(gmdapi-zlib PUBLIC ${gmdapi_zlib_SOURCE_DIR})
+    if (MSVC)
+        target_compile_definitions(gmdapi-zlib PRIVATE _CRT_SECURE_NO_DEPRECATE _CRT_NONSTDC_NO_DEPRECATE)
+    endif()
+    # linked into the mod, which is a shared library
+    set_target_properties(gmdapi-zlib PROPERTIES POSITION_INDEPENDENT_CODE ON)
+
+    add_library(ZLIB::ZLIB ALIAS gmdapi-zlib)
+endif()
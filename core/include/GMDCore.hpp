@@ -0,0 +1,392 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * The format logic of GMD-API, without any game bindings. Everything here
+ * works on plain strings and bytes, so it can be used both by the mod and
+ * by tools that run without the game
+ */
+namespace gmd::core {
+    template <class T = void>
+    using Result = std::expected<T, std::string>;
+
+    using ByteVector = std::vector<uint8_t>;
+
+    enum class LevelFormat {
+        Lvl,
+        Gmd,
+        Gmd2,
+    };
+    enum class ListFormat {
+        Gmdl,
+    };
+
+    constexpr const char* levelFormatToString(LevelFormat format) {
+        switch (format) {
+            case LevelFormat::Lvl:  return "lvl";
+            case LevelFormat::Gmd:  return "gmd";
+            case LevelFormat::Gmd2: return "gmd2";
+            default:                return nullptr;
+        }
+    }
+    constexpr std::optional<LevelFormat> levelFormatFromString(std::string_view format) {
+        if (format == "lvl")  return LevelFormat::Lvl;
+        if (format == "gmd")  return LevelFormat::Gmd;
+        if (format == "gmd2") return LevelFormat::Gmd2;
+        return std::nullopt;
+    }
+
+    constexpr const char* listFormatToString(ListFormat format) {
+        switch (format) {
+            case ListFormat::Gmdl: return "gmdl";
+            default:               return nullptr;
+        }
+    }
+    constexpr std::optional<ListFormat> listFormatFromString(std::string_view format) {
+        if (format == "gmdl") return ListFormat::Gmdl;
+        return std::nullopt;
+    }
+
+    /**
+     * Get the extension of a path without the leading dot
+     */
+    std::string extensionWithoutDot(std::filesystem::path const& path);
+
+    /**
+     * Keeps track of the estimated amount of memory held by an import at any
+     * given moment, and refuses to go over an optional limit
+     */
+    class ImportBudget final {
+    private:
+        std::optional<size_t> m_limit;
+        size_t m_used = 0;
+
+    public:
+        ImportBudget(std::optional<size_t> limit);
+
+        /**
+         * Account for a new allocation of `bytes`
+         * @param what What the memory is needed for; used in the error message
+         * @returns Err if the allocation would go over the limit
+         */
+        Result<> acquire(size_t bytes, std::string_view what);
+        void release(size_t bytes);
+
+        /**
+         * How many bytes can still be acquired, or SIZE_MAX if there is no limit
+         */
+        size_t remaining() const;
+    };
+
+    /**
+     * Bump allocator for the temporaries of a single import, like the zip 
+     * directory, read buffers and entry list. Memory is handed back in bulk 
+     * when a Scope ends, and the blocks behind it are kept to be reused by 
+     * the next stage of the import until the arena is destroyed
+     */
+    class ImportArena final {
+    private:
+        struct Block {
+            std::unique_ptr<std::byte[]> data;
+            size_t size;
+        };
+        std::array<std::byte, 4096> m_initial;
+        std::vector<Block> m_blocks;
+        // 0 is m_initial, n is m_blocks[n - 1]
+        size_t m_block = 0;
+        std::byte* m_current;
+        size_t m_left;
+
+    public:
+        /**
+         * Hands back everything allocated from the arena during its lifetime 
+         * when it ends. Whatever uses that memory has to be destroyed first, 
+         * so declare the scope before it
+         */
+        class Scope final {
+        private:
+            ImportArena* m_arena;
+            size_t m_block = 0;
+            std::byte* m_current = nullptr;
+            size_t m_left = 0;
+
+        public:
+            /**
+             * @param arena The arena to scope, or null to do nothing
+             */
+            Scope(ImportArena* arena);
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+            ~Scope();
+        };
+
+        ImportArena();
+        ImportArena(ImportArena const&) = delete;
+        ImportArena& operator=(ImportArena const&) = delete;
+
+        /**
+         * Allocate memory that stays valid until the enclosing Scope ends, or
+         * until the arena is destroyed
+         */
+        void* allocate(size_t size, size_t alignment);
+    };
+
+    /**
+     * Standard allocator that allocates from an ImportArena, or from the heap
+     * if it has none
+     */
+    template <class T>
+    class ArenaAllocator {
+    private:
+        ImportArena* m_arena = nullptr;
+
+    public:
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+
+        ArenaAllocator() noexcept = default;
+        ArenaAllocator(ImportArena* arena) noexcept : m_arena(arena) {}
+        template <class U>
+        ArenaAllocator(ArenaAllocator<U> const& other) noexcept : m_arena(other.getArena()) {}
+
+        T* allocate(size_t count) {
+            if (!m_arena) {
+                return std::allocator<T>().allocate(count);
+            }
+            if (count > SIZE_MAX / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+        }
+        void deallocate(T* ptr, size_t count) noexcept {
+            // arena memory is freed all at once with the arena
+            if (!m_arena) {
+                std::allocator<T>().deallocate(ptr, count);
+            }
+        }
+
+        ImportArena* getArena() const noexcept {
+            return m_arena;
+        }
+
+        template <class U>
+        bool operator==(ArenaAllocator<U> const& other) const noexcept {
+            return m_arena == other.getArena();
+        }
+    };
+
+    template <class T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    size_t saturatingMul(size_t a, size_t b);
+
+    /**
+     * Inflate GZip or Zlib compressed data, giving up as soon as the output
+     * would become larger than `maxSize` instead of after the fact
+     */
+    Result<std::string> inflateBounded(uint8_t const* data, size_t size, size_t maxSize);
+    /**
+     * Compress data into a Zlib stream, like ZipUtils::ccDeflateMemory
+     * @param level Zlib compression level, from 0 (none) to 9 (best)
+     */
+    Result<ByteVector> deflateZlib(std::string_view data, int level);
+
+    /**
+     * Read-only access to a Zip file that only loads the central directory
+     * up front, and extracts entries one by one straight from disk
+     */
+    class ZipReader final {
+    public:
+        struct Entry {
+            std::string_view name;
+            uint16_t method;
+            uint32_t crc;
+            size_t compressed;
+            size_t uncompressed;
+            size_t localHeaderOffset;
+        };
+
+    private:
+        std::ifstream m_file;
+        size_t m_fileSize = 0;
+        ImportArena* m_arena;
+        ArenaVector<Entry> m_entries;
+        // the entry names, which entries point into
+        ArenaVector<char> m_names;
+
+        ZipReader(ImportArena* arena);
+
+        Result<> readDirectory(ImportBudget* budget);
+        template <class Container>
+        Result<> extractInto(Entry const& entry, Container& out);
+
+    public:
+        /**
+         * Open a Zip file and read its central directory
+         * @param arena Where to allocate the entry list and read buffers from, 
+         * or null for the heap
+         * @param budget Memory budget the directory is checked against before 
+         * it's read, or null for no limit. The entry list stays acquired for 
+         * as long as the reader lives
+         */
+        static Result<ZipReader> open(
+            std::filesystem::path const& path, ImportArena* arena = nullptr, ImportBudget* budget = nullptr
+        );
+
+        ArenaVector<Entry> const& getEntries() const;
+        Entry const* getEntry(std::string_view name) const;
+
+        /**
+         * Extract an entry. Fails without allocating if the entry's declared
+         * size is over `maxSize`
+         */
+        Result<std::string> extract(std::string_view name, size_t maxSize = SIZE_MAX);
+        Result<ByteVector> extractBytes(std::string_view name, size_t maxSize = SIZE_MAX);
+    };
+
+    /**
+     * Builds a Zip file in memory
+     */
+    class ZipWriter final {
+    private:
+        struct Entry {
+            std::string name;
+            uint16_t method;
+            uint32_t crc;
+            size_t compressed;
+            size_t uncompressed;
+            size_t localHeaderOffset;
+        };
+
+        int m_level;
+        ByteVector m_data;
+        std::vector<Entry> m_entries;
+
+        Result<> addData(std::string_view name, uint8_t const* data, size_t size);
+
+    public:
+        /**
+         * @param level Zlib compression level, from 0 (none) to 9 (best)
+         */
+        ZipWriter(int level);
+
+        Result<> add(std::string_view name, std::string_view data);
+        Result<> add(std::string_view name, ByteVector const& data);
+        /**
+         * Write the central directory and get the finished Zip file
+         */
+        Result<ByteVector> finish() &&;
+    };
+
+    /**
+     * Add the wrappers DS_Dictionary needs to Plist data from level and list
+     * files, in-place
+     * @returns True if the data is from an old GDShare file, which stored
+     * the level's fields without any Plist wrapper (and with the description
+     * encoded twice)
+     */
+    bool normalizePlist(std::string& str);
+    /**
+     * Check that Plist data is well-formed, i.e. that its tags are balanced
+     */
+    Result<> validatePlist(std::string_view str);
+
+    /**
+     * An entry of a Gmd2 file other than the level data and metadata
+     */
+    struct ExtraEntry {
+        std::string_view name;
+        /**
+         * Set to extract the entry into LevelFile::extras
+         */
+        bool extract = false;
+    };
+
+    struct ReadOptions {
+        /**
+         * Upper bound (in bytes) for the memory used at once while reading
+         */
+        std::optional<size_t> memoryLimit;
+        /**
+         * Maximum ratio between the decompressed and compressed size of the
+         * level data in Lvl and Gmd2 files
+         */
+        std::optional<size_t> maxInflateRatio;
+        /**
+         * Roughly how many bytes the caller needs per byte of level data to 
+         * process it after reading, e.g. to parse it. Level data that would 
+         * need more than the memory limit is rejected before it's read or 
+         * decompressed, instead of after
+         */
+        size_t parseCostFactor = 1;
+        /**
+         * Choose which entries of a Gmd2 file other than the level data and
+         * metadata to extract, like the song file, by setting their `extract`.
+         * Called once the metadata has been read, so nothing is extracted 
+         * before the caller has checked it. Returning an error fails the 
+         * read; by default no extra entries are extracted
+         */
+        std::function<Result<>(std::string_view meta, std::span<ExtraEntry> entries)> selectExtras;
+        /**
+         * Where to allocate the temporaries of reading from, like the Gmd2 
+         * zip directory and read buffers, or null for the heap
+         */
+        ImportArena* arena = nullptr;
+    };
+
+    struct WriteOptions {
+        /**
+         * Zlib compression level used for Lvl and Gmd2 files
+         */
+        int compressionLevel = 6;
+    };
+
+    /**
+     * A level file's contents independent of the format it's stored in
+     */
+    struct LevelFile {
+        /**
+         * The level as Plist data, as stored in Gmd files
+         */
+        std::string data;
+        /**
+         * Gmd2 metadata as JSON. Other formats have no metadata
+         */
+        std::string meta = "{}";
+        /**
+         * Other files packaged with a Gmd2 file, like the level's song
+         */
+        std::vector<std::pair<std::string, ByteVector>> extras;
+    };
+
+    Result<LevelFile> readLevelFile(
+        std::filesystem::path const& path, LevelFormat format, ReadOptions const& options = {}
+    );
+    /**
+     * @note Metadata and extras are only stored in Gmd2 files, and are
+     * silently dropped by the other formats
+     */
+    Result<ByteVector> writeLevelFile(
+        LevelFile const& file, LevelFormat format, WriteOptions const& options = {}
+    );
+
+    Result<std::string> readListFile(
+        std::filesystem::path const& path, ListFormat format, ReadOptions const& options = {}
+    );
+    Result<ByteVector> writeListFile(
+        std::string_view data, ListFormat format, WriteOptions const& options = {}
+    );
+}
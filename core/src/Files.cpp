@@ -0,0 +1,206 @@
+#include "Internal.hpp"
+#include <algorithm>
+
+using namespace gmd::core;
+
+std::string gmd::core::extensionWithoutDot(std::filesystem::path const& path) {
+    auto ext = path.extension().string();
+    if (ext.size()) {
+        return ext.substr(1);
+    }
+    return "";
+}
+
+static Result<size_t> getFileSize(std::filesystem::path const& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return fail("Unable to read ", path.string(), ": ", ec.message());
+    }
+    return static_cast<size_t>(size);
+}
+
+/**
+ * Check that the caller can still afford to process `size` bytes of level 
+ * data after reading it
+ */
+static Result<> checkDataSize(size_t size, ReadOptions const& options) {
+    auto factor = std::max<size_t>(options.parseCostFactor, 1);
+    if (options.memoryLimit && saturatingMul(size, factor) > *options.memoryLimit) {
+        return fail(
+            "Level data of ", size, " bytes would need about ", saturatingMul(size, factor),
+            " bytes to load, which is over the memory limit of ", *options.memoryLimit, " bytes"
+        );
+    }
+    return {};
+}
+
+static Result<LevelFile> readGmd2(
+    std::filesystem::path const& path, ReadOptions const& options, ImportBudget& budget
+) {
+    GMDCORE_UNWRAP_INTO(
+        auto zip, withContext(ZipReader::open(path, options.arena, &budget), "Unable to read file")
+    );
+
+    // the sizes the zip declares for its entries are checked before
+    // extracting anything, so zip bombs are caught without inflating them
+    auto checkEntry = [&](std::string_view name) -> Result<size_t> {
+        auto entry = zip.getEntry(name);
+        if (!entry) {
+            return fail("Entry '", name, "' not found");
+        }
+        if (options.maxInflateRatio && entry->uncompressed > saturatingMul(
+            std::max<size_t>(entry->compressed, 1), *options.maxInflateRatio
+        )) {
+            return fail(
+                "'", name, "' decompresses to ", entry->uncompressed, " bytes from ",
+                entry->compressed, " bytes, which is over the allowed ratio of ",
+                *options.maxInflateRatio
+            );
+        }
+        return entry->uncompressed;
+    };
+
+    LevelFile file;
+
+    GMDCORE_UNWRAP_INTO(auto metaSize, withContext(checkEntry("level.meta"), "Unable to read metadata"));
+    GMDCORE_UNWRAP(budget.acquire(metaSize, "reading metadata"));
+    GMDCORE_UNWRAP_INTO(file.meta, withContext(zip.extract("level.meta"), "Unable to read metadata"));
+
+    if (options.selectExtras) {
+        ImportArena::Scope scope(options.arena);
+        ArenaVector<ExtraEntry> extras(options.arena);
+        for (auto& entry : zip.getEntries()) {
+            if (entry.name != "level.meta" && entry.name != "level.data" && !entry.name.ends_with('/')) {
+                extras.push_back(ExtraEntry { entry.name, false });
+            }
+        }
+        GMDCORE_UNWRAP(options.selectExtras(file.meta, extras));
+        for (auto& extra : extras) {
+            if (!extra.extract) {
+                continue;
+            }
+            GMDCORE_UNWRAP_INTO(auto size, withContext(checkEntry(extra.name), "Unable to read packaged file"));
+            GMDCORE_UNWRAP(budget.acquire(size, "reading packaged files"));
+            GMDCORE_UNWRAP_INTO(
+                auto data, withContext(zip.extractBytes(extra.name), "Unable to read packaged file")
+            );
+            file.extras.emplace_back(std::string(extra.name), std::move(data));
+        }
+    }
+
+    GMDCORE_UNWRAP_INTO(auto dataSize, withContext(checkEntry("level.data"), "Unable to read level data"));
+    GMDCORE_UNWRAP(checkDataSize(dataSize, options));
+    GMDCORE_UNWRAP(budget.acquire(dataSize, "reading level data"));
+    GMDCORE_UNWRAP_INTO(file.data, withContext(zip.extract("level.data"), "Unable to read level data"));
+
+    return file;
+}
+
+Result<LevelFile> gmd::core::readLevelFile(
+    std::filesystem::path const& path, LevelFormat format, ReadOptions const& options
+) {
+    auto budget = ImportBudget(options.memoryLimit);
+    GMDCORE_UNWRAP_INTO(auto fileSize, getFileSize(path));
+
+    switch (format) {
+        case LevelFormat::Gmd: {
+            GMDCORE_UNWRAP(checkDataSize(fileSize, options));
+            GMDCORE_UNWRAP(budget.acquire(fileSize, "reading the file"));
+            LevelFile file;
+            GMDCORE_UNWRAP_INTO(
+                file.data, withContext(readFile<std::string>(path), "Unable to read " + path.string())
+            );
+            return file;
+        } break;
+
+        case LevelFormat::Lvl: {
+            GMDCORE_UNWRAP(budget.acquire(fileSize, "reading the file"));
+            GMDCORE_UNWRAP_INTO(
+                auto data, withContext(readFile<ByteVector>(path), "Unable to read " + path.string())
+            );
+            // the decompressed data has to fit next to the compressed data 
+            // now, and be affordable to process once that's freed
+            auto maxSize = budget.remaining();
+            if (options.memoryLimit) {
+                maxSize = std::min(maxSize, *options.memoryLimit / std::max<size_t>(options.parseCostFactor, 1));
+            }
+            if (options.maxInflateRatio) {
+                maxSize = std::min(maxSize, saturatingMul(data.size(), *options.maxInflateRatio));
+            }
+            // the compressed data is freed as soon as this returns
+            LevelFile file;
+            GMDCORE_UNWRAP_INTO(file.data, inflateBounded(data.data(), data.size(), maxSize));
+            return file;
+        } break;
+
+        case LevelFormat::Gmd2: {
+            return readGmd2(path, options, budget);
+        } break;
+
+        default: {
+            return fail("Unknown file type");
+        } break;
+    }
+}
+
+Result<ByteVector> gmd::core::writeLevelFile(
+    LevelFile const& file, LevelFormat format, WriteOptions const& options
+) {
+    switch (format) {
+        case LevelFormat::Gmd: {
+            return ByteVector(file.data.begin(), file.data.end());
+        } break;
+
+        case LevelFormat::Lvl: {
+            return withContext(deflateZlib(file.data, options.compressionLevel), "Unable to compress level data");
+        } break;
+
+        case LevelFormat::Gmd2: {
+            ZipWriter zip(options.compressionLevel);
+            for (auto& [name, data] : file.extras) {
+                GMDCORE_UNWRAP(zip.add(name, data));
+            }
+            GMDCORE_UNWRAP(zip.add("level.meta", file.meta));
+            GMDCORE_UNWRAP(zip.add("level.data", file.data));
+            return std::move(zip).finish();
+        } break;
+
+        default: {
+            return fail("Unknown file type");
+        } break;
+    }
+}
+
+Result<std::string> gmd::core::readListFile(
+    std::filesystem::path const& path, ListFormat format, ReadOptions const& options
+) {
+    auto budget = ImportBudget(options.memoryLimit);
+    GMDCORE_UNWRAP_INTO(auto fileSize, getFileSize(path));
+
+    switch (format) {
+        case ListFormat::Gmdl: {
+            GMDCORE_UNWRAP(checkDataSize(fileSize, options));
+            GMDCORE_UNWRAP(budget.acquire(fileSize, "reading the file"));
+            return withContext(readFile<std::string>(path), "Unable to read " + path.string());
+        } break;
+
+        default: {
+            return fail("Unknown file type");
+        } break;
+    }
+}
+
+Result<ByteVector> gmd::core::writeListFile(
+    std::string_view data, ListFormat format, WriteOptions const&
+) {
+    switch (format) {
+        case ListFormat::Gmdl: {
+            return ByteVector(data.begin(), data.end());
+        } break;
+
+        default: {
+            return fail("Unknown file type");
+        } break;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <GMDCore.hpp>
+#include <charconv>
+#include <concepts>
+
+#define GMDCORE_CONCAT_IMPL(a, b) a##b
+#define GMDCORE_CONCAT(a, b) GMDCORE_CONCAT_IMPL(a, b)
+
+#define GMDCORE_UNWRAP_INTO_IMPL(res, variable, ...)                    \
+    auto res = (__VA_ARGS__);                                           \
+    if (!res) return std::unexpected(std::move(res.error()));           \
+    variable = std::move(*res)
+
+/**
+ * Like GEODE_UNWRAP_INTO, but for gmd::core::Result
+ */
+#define GMDCORE_UNWRAP_INTO(variable, ...) \
+    GMDCORE_UNWRAP_INTO_IMPL(GMDCORE_CONCAT(res_, __LINE__), variable, __VA_ARGS__)
+
+/**
+ * Like GEODE_UNWRAP, but for gmd::core::Result
+ */
+#define GMDCORE_UNWRAP(...) do {                                        \
+        auto res_ = (__VA_ARGS__);                                      \
+        if (!res_) return std::unexpected(std::move(res_.error()));     \
+    } while (false)
+
+namespace gmd::core {
+    template <class T>
+    void appendTo(std::string& out, T const& value) {
+        if constexpr (std::same_as<T, char>) {
+            out.push_back(value);
+        }
+        else if constexpr (std::is_arithmetic_v<T>) {
+            char buffer[32];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, res.ptr);
+        }
+        else {
+            out.append(std::string_view(value));
+        }
+    }
+
+    /**
+     * Create an error out of all the arguments printed after each other
+     */
+    template <class... Args>
+    std::unexpected<std::string> fail(Args const&... args) {
+        std::string res;
+        (appendTo(res, args), ...);
+        return std::unexpected(std::move(res));
+    }
+
+    /**
+     * Prefix the error of a Result with some context
+     */
+    template <class T>
+    Result<T> withContext(Result<T>&& res, std::string_view context) {
+        if (!res) {
+            return fail(context, ": ", res.error());
+        }
+        return std::move(res);
+    }
+
+    template <class T>
+    T readLE(uint8_t const* data) {
+        T res = 0;
+        for (size_t i = 0; i < sizeof(T); i += 1) {
+            res |= static_cast<T>(data[i]) << (i * 8);
+        }
+        return res;
+    }
+    template <class T>
+    void writeLE(ByteVector& out, T value) {
+        for (size_t i = 0; i < sizeof(T); i += 1) {
+            out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    /**
+     * Compress data with Zlib
+     * @param windowBits 15 for a Zlib stream, -15 for raw Deflate as used in
+     * Zip files
+     */
+    Result<ByteVector> deflateData(uint8_t const* data, size_t size, int level, int windowBits);
+
+    /**
+     * Read a whole file into a string or a byte vector
+     */
+    template <class T>
+    Result<T> readFile(std::filesystem::path const& path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return fail("Unable to open file");
+        }
+        T res;
+        res.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(res.data()), res.size());
+        if (!file) {
+            return fail("Unable to read file");
+        }
+        return res;
+    }
+}
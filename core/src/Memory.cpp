@@ -0,0 +1,173 @@
+#include "Internal.hpp"
+#include <algorithm>
+#include <climits>
+#include <zlib.h>
+
+using namespace gmd::core;
+
+ImportBudget::ImportBudget(std::optional<size_t> limit) : m_limit(limit) {}
+
+Result<> ImportBudget::acquire(size_t bytes, std::string_view what) {
+    if (m_limit && bytes > this->remaining()) {
+        return fail(
+            "Importing would exceed the memory limit of ", *m_limit, " bytes while ", what,
+            " (", m_used, " bytes in use, ", bytes, " more needed)"
+        );
+    }
+    m_used += bytes;
+    return {};
+}
+void ImportBudget::release(size_t bytes) {
+    m_used -= std::min(bytes, m_used);
+}
+size_t ImportBudget::remaining() const {
+    if (!m_limit) {
+        return SIZE_MAX;
+    }
+    return m_used < *m_limit ? *m_limit - m_used : 0;
+}
+
+ImportArena::Scope::Scope(ImportArena* arena) : m_arena(arena) {
+    if (m_arena) {
+        m_block = m_arena->m_block;
+        m_current = m_arena->m_current;
+        m_left = m_arena->m_left;
+    }
+}
+ImportArena::Scope::~Scope() {
+    if (m_arena) {
+        m_arena->m_block = m_block;
+        m_arena->m_current = m_current;
+        m_arena->m_left = m_left;
+    }
+}
+
+ImportArena::ImportArena() {
+    m_current = m_initial.data();
+    m_left = m_initial.size();
+}
+
+static size_t paddingFor(std::byte* ptr, size_t alignment) {
+    return (alignment - reinterpret_cast<uintptr_t>(ptr) % alignment) % alignment;
+}
+
+void* ImportArena::allocate(size_t size, size_t alignment) {
+    auto padding = paddingFor(m_current, alignment);
+    if (padding + size > m_left) {
+        if (size > SIZE_MAX - alignment) {
+            throw std::bad_alloc();
+        }
+        // reuse the next block if a scope handed it back and it's big enough, 
+        // otherwise add one in front of it. Blocks grow geometrically, but 
+        // always fit the request
+        if (m_block >= m_blocks.size() || m_blocks[m_block].size < size + alignment) {
+            constexpr size_t MIN_BLOCK_SIZE = 8192;
+            auto blockSize = std::max(MIN_BLOCK_SIZE << std::min<size_t>(m_blocks.size(), 8), size + alignment);
+            m_blocks.insert(m_blocks.begin() + m_block, Block {
+                std::make_unique_for_overwrite<std::byte[]>(blockSize), blockSize
+            });
+        }
+        auto& block = m_blocks[m_block];
+        m_block += 1;
+        m_current = block.data.get();
+        m_left = block.size;
+        padding = paddingFor(m_current, alignment);
+    }
+    auto ptr = m_current + padding;
+    m_current = ptr + size;
+    m_left -= padding + size;
+    return ptr;
+}
+
+size_t gmd::core::saturatingMul(size_t a, size_t b) {
+    if (a && b > SIZE_MAX / a) {
+        return SIZE_MAX;
+    }
+    return a * b;
+}
+
+Result<std::string> gmd::core::inflateBounded(uint8_t const* data, size_t size, size_t maxSize) {
+    z_stream stream {};
+    // 15 + 32 = auto-detect between GZip and Zlib headers, same as ZipUtils
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return fail("Unable to initialize decompression");
+    }
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(std::min<size_t>(size, UINT_MAX));
+
+    constexpr size_t CHUNK_SIZE = 256 * 1024;
+    std::string out;
+    size_t written = 0;
+
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (written == out.size()) {
+            if (written >= maxSize) {
+                inflateEnd(&stream);
+                return fail("Decompressed level data is larger than the allowed ", maxSize, " bytes");
+            }
+            // start from a guess based on the input so small levels don't
+            // allocate a whole chunk, then double. The new buffer is a fresh
+            // string since reserve on a growing one may round its capacity
+            // up past maxSize
+            auto capacity = written ?
+                saturatingMul(written, 2) :
+                std::clamp<size_t>(saturatingMul(size, 4), 4096, CHUNK_SIZE);
+            std::string next;
+            next.reserve(std::min(capacity, maxSize));
+            next.assign(out, 0, written);
+            next.resize(std::min(capacity, maxSize));
+            out = std::move(next);
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + written);
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - written, UINT_MAX));
+        auto before = stream.avail_out;
+
+        status = inflate(&stream, Z_NO_FLUSH);
+        written += before - stream.avail_out;
+
+        if (status != Z_OK && status != Z_STREAM_END) {
+            inflateEnd(&stream);
+            return fail("Unable to decompress level data");
+        }
+        // no progress possible and the stream isn't finished, so the input
+        // must be truncated
+        if (status == Z_OK && stream.avail_in == 0 && stream.avail_out != 0) {
+            inflateEnd(&stream);
+            return fail("Unable to decompress level data: unexpected end of data");
+        }
+    }
+    inflateEnd(&stream);
+    // shrinking only moves the terminator, it doesn't copy the data
+    out.resize(written);
+    return out;
+}
+
+Result<ByteVector> gmd::core::deflateData(uint8_t const* data, size_t size, int level, int windowBits) {
+    z_stream stream {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return fail("Unable to initialize compression");
+    }
+    if (size > UINT_MAX) {
+        deflateEnd(&stream);
+        return fail("Data is too large to compress");
+    }
+    ByteVector out(deflateBound(&stream, static_cast<uLong>(size)));
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    // deflateBound guarantees a single call is enough
+    auto status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        return fail("Unable to compress data");
+    }
+    out.resize(stream.total_out);
+    return out;
+}
+
+Result<ByteVector> gmd::core::deflateZlib(std::string_view data, int level) {
+    return deflateData(reinterpret_cast<uint8_t const*>(data.data()), data.size(), level, 15);
+}
@@ -0,0 +1,86 @@
+#include "Internal.hpp"
+
+using namespace gmd::core;
+
+static void removeNullbytesFromString(std::string& str) {
+    for (auto& c : str) {
+        if (!c) c = ' ';
+    }
+}
+
+static void wrapString(std::string& str, std::string_view prefix, std::string_view suffix) {
+    // reserve once so the insert below moves the data in-place instead of
+    // building a second full-size copy of the level
+    str.reserve(str.size() + prefix.size() + suffix.size());
+    str.insert(0, prefix);
+    str.append(suffix);
+}
+
+bool gmd::core::normalizePlist(std::string& value) {
+    removeNullbytesFromString(value);
+
+    // add gjver if it's missing as otherwise DS_Dictionary fails to load the data
+    auto pos = std::string_view(value).substr(0, 100).find("<plist version=\"1.0\">");
+    if (pos != std::string::npos) {
+        value.replace(pos, 21, "<plist version=\"1.0\" gjver=\"2.0\">");
+    }
+    bool isOldFile = false;
+    if (!value.starts_with("<?xml version")) {
+        if (std::string_view(value).substr(0, 100).find("<plist version") == std::string::npos) {
+            isOldFile = true;
+            wrapString(
+                value,
+                "<?xml version=\"1.0\"?><plist version=\"1.0\" gjver=\"2.0\"><dict><k>root</k>",
+                "</dict></plist>"
+            );
+        }
+        else {
+            wrapString(value, "<?xml version=\"1.0\"?>", "");
+        }
+    }
+    return isOldFile;
+}
+
+Result<> gmd::core::validatePlist(std::string_view str) {
+    std::vector<std::string_view> open;
+    bool hasPlist = false;
+    size_t pos = 0;
+    while ((pos = str.find('<', pos)) != std::string_view::npos) {
+        auto end = str.find('>', pos);
+        if (end == std::string_view::npos) {
+            return fail("Unterminated tag at offset ", pos);
+        }
+        auto tag = str.substr(pos + 1, end - pos - 1);
+        auto tagOffset = pos;
+        pos = end + 1;
+
+        // declarations like <?xml ...?>
+        if (tag.starts_with('?') || tag.starts_with('!')) {
+            continue;
+        }
+        // self-closing tags like <t/>
+        if (tag.ends_with('/')) {
+            continue;
+        }
+        if (tag.starts_with('/')) {
+            auto name = tag.substr(1);
+            if (open.empty() || open.back() != name) {
+                return fail("Unexpected closing tag </", name, "> at offset ", tagOffset);
+            }
+            open.pop_back();
+            continue;
+        }
+        auto name = tag.substr(0, tag.find_first_of(" \t\r\n"));
+        if (name == "plist") {
+            hasPlist = true;
+        }
+        open.push_back(name);
+    }
+    if (!open.empty()) {
+        return fail("Tag <", open.back(), "> is never closed");
+    }
+    if (!hasPlist) {
+        return fail("Data has no <plist> root");
+    }
+    return {};
+}
@@ -0,0 +1,439 @@
+#include "Internal.hpp"
+#include <algorithm>
+#include <climits>
+#include <zlib.h>
+
+using namespace gmd::core;
+
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t CD_ENTRY_SIGNATURE = 0x02014b50;
+constexpr uint32_t EOCD_SIGNATURE = 0x06054b50;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t CD_ENTRY_SIZE = 46;
+constexpr size_t EOCD_SIZE = 22;
+constexpr size_t MAX_COMMENT_SIZE = 0xffff;
+// the best deflate can do is a 258 byte match in every 2 bits
+constexpr size_t MAX_DEFLATE_RATIO = 1032;
+
+constexpr uint16_t METHOD_STORE = 0;
+constexpr uint16_t METHOD_DEFLATE = 8;
+// bit 11 = names are UTF-8
+constexpr uint16_t ZIP_FLAGS = 0x0800;
+constexpr uint16_t ZIP_VERSION = 20;
+// fixed timestamp (1980-01-01 00:00) so the same level always produces the
+// same file
+constexpr uint16_t ZIP_TIME = 0;
+constexpr uint16_t ZIP_DATE = (1 << 5) | 1;
+
+ZipReader::ZipReader(ImportArena* arena) : m_arena(arena), m_entries(arena), m_names(arena) {}
+
+Result<ZipReader> ZipReader::open(
+    std::filesystem::path const& path, ImportArena* arena, ImportBudget* budget
+) {
+    ZipReader reader(arena);
+    reader.m_file.open(path, std::ios::binary);
+    if (!reader.m_file) {
+        return fail("Unable to open file");
+    }
+    GMDCORE_UNWRAP(reader.readDirectory(budget));
+    return reader;
+}
+
+Result<> ZipReader::readDirectory(ImportBudget* budget) {
+    // the directory's size comes from the file, so it's checked against the 
+    // budget before anything is allocated for it
+    auto acquire = [&](size_t bytes) -> Result<> {
+        return budget ? budget->acquire(bytes, "reading the zip directory") : Result<>();
+    };
+    auto release = [&](size_t bytes) {
+        if (budget) budget->release(bytes);
+    };
+
+    m_file.seekg(0, std::ios::end);
+    m_fileSize = m_file.tellg();
+    if (m_fileSize < EOCD_SIZE) {
+        return fail("File is too small to be a zip");
+    }
+
+    // the end of central directory record is at the end of the file,
+    // possibly followed by a comment
+    auto tailSize = std::min(m_fileSize, EOCD_SIZE + MAX_COMMENT_SIZE);
+    GMDCORE_UNWRAP(acquire(tailSize));
+    size_t cdCount, cdSize, cdOffset;
+    {
+        // the tail is only needed to find the directory, so it's handed back 
+        // to the arena before the entry list is allocated
+        ImportArena::Scope scope(m_arena);
+        ArenaVector<uint8_t> tail(tailSize, m_arena);
+        m_file.seekg(m_fileSize - tailSize);
+        m_file.read(reinterpret_cast<char*>(tail.data()), tailSize);
+        if (!m_file) {
+            return fail("Unable to read file");
+        }
+        std::optional<size_t> eocd;
+        for (size_t i = tailSize - EOCD_SIZE + 1; i-- > 0;) {
+            if (readLE<uint32_t>(tail.data() + i) == EOCD_SIGNATURE) {
+                eocd = i;
+                break;
+            }
+        }
+        if (!eocd) {
+            return fail("Unable to find zip central directory");
+        }
+        cdCount = readLE<uint16_t>(tail.data() + *eocd + 10);
+        cdSize = readLE<uint32_t>(tail.data() + *eocd + 12);
+        cdOffset = readLE<uint32_t>(tail.data() + *eocd + 16);
+    }
+    if (cdCount == 0xffff || cdSize == 0xffffffff || cdOffset == 0xffffffff) {
+        return fail("Zip64 archives are not supported");
+    }
+    if (cdOffset > m_fileSize || cdSize > m_fileSize - cdOffset) {
+        return fail("Zip central directory is out of bounds");
+    }
+    if (cdCount > cdSize / CD_ENTRY_SIZE) {
+        return fail("Zip central directory is too small for ", cdCount, " entries");
+    }
+
+    // the raw directory, plus the entry list and names parsed out of it, 
+    // which are never longer than the raw directory
+    auto entriesSize = saturatingMul(cdCount, sizeof(Entry)) + cdSize;
+    GMDCORE_UNWRAP(acquire(cdSize));
+    GMDCORE_UNWRAP(acquire(entriesSize));
+
+    m_entries.reserve(cdCount);
+    // every name is part of its entry's record, so together they fit in 
+    // what's left of the directory after the fixed-size parts
+    m_names.reserve(cdSize - cdCount * CD_ENTRY_SIZE);
+
+    // the raw directory is handed back once the entries are parsed out of it
+    ImportArena::Scope scope(m_arena);
+    ArenaVector<uint8_t> cd(cdSize, m_arena);
+    m_file.seekg(cdOffset);
+    m_file.read(reinterpret_cast<char*>(cd.data()), cdSize);
+    if (!m_file) {
+        return fail("Unable to read zip central directory");
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < cdCount; i += 1) {
+        if (offset + CD_ENTRY_SIZE > cd.size() || readLE<uint32_t>(cd.data() + offset) != CD_ENTRY_SIGNATURE) {
+            return fail("Zip central directory is corrupted");
+        }
+        auto entry = cd.data() + offset;
+        auto nameLen = readLE<uint16_t>(entry + 28);
+        auto extraLen = readLE<uint16_t>(entry + 30);
+        auto commentLen = readLE<uint16_t>(entry + 32);
+        if (offset + CD_ENTRY_SIZE + nameLen + extraLen + commentLen > cd.size()) {
+            return fail("Zip central directory is corrupted");
+        }
+        auto nameStart = m_names.size();
+        m_names.insert(m_names.end(), entry + CD_ENTRY_SIZE, entry + CD_ENTRY_SIZE + nameLen);
+        Entry res {
+            .name = std::string_view(m_names.data() + nameStart, nameLen),
+            .method = readLE<uint16_t>(entry + 10),
+            .crc = readLE<uint32_t>(entry + 16),
+            .compressed = readLE<uint32_t>(entry + 20),
+            .uncompressed = readLE<uint32_t>(entry + 24),
+            .localHeaderOffset = readLE<uint32_t>(entry + 42),
+        };
+
+        // Zip64 entries store their real sizes in an extra field, in this
+        // order and only if the regular field is maxed out
+        auto extra = entry + CD_ENTRY_SIZE + nameLen;
+        for (size_t e = 0; e + 4 <= extraLen;) {
+            auto id = readLE<uint16_t>(extra + e);
+            auto len = readLE<uint16_t>(extra + e + 2);
+            auto end = std::min<size_t>(e + 4 + len, extraLen);
+            if (id == 0x0001) {
+                size_t field = e + 4;
+                for (auto value : { &res.uncompressed, &res.compressed, &res.localHeaderOffset }) {
+                    if (*value == 0xffffffff && field + 8 <= end) {
+                        *value = static_cast<size_t>(readLE<uint64_t>(extra + field));
+                        field += 8;
+                    }
+                }
+            }
+            e += 4 + len;
+        }
+
+        m_entries.push_back(std::move(res));
+        offset += CD_ENTRY_SIZE + nameLen + extraLen + commentLen;
+    }
+    // only the entry list outlives this. An arena keeps the memory of the 
+    // tail and directory around for reuse though, so it stays acquired then
+    if (!m_arena) {
+        release(tailSize + cdSize);
+    }
+    return {};
+}
+
+ArenaVector<ZipReader::Entry> const& ZipReader::getEntries() const {
+    return m_entries;
+}
+
+ZipReader::Entry const* ZipReader::getEntry(std::string_view name) const {
+    auto it = std::ranges::find(m_entries, name, &Entry::name);
+    return it != m_entries.end() ? &*it : nullptr;
+}
+
+/**
+ * Make room for more output without trusting the entry's declared size, which
+ * comes straight from the file. The buffer starts from a guess based on the 
+ * compressed size and doubles, but never past the declared size
+ */
+template <class Container>
+static void growOutput(Container& out, size_t written, size_t compressed, size_t declared) {
+    constexpr size_t CHUNK_SIZE = 256 * 1024;
+    auto capacity = written ?
+        saturatingMul(written, 2) :
+        std::clamp<size_t>(saturatingMul(compressed, 4), 4096, CHUNK_SIZE);
+    capacity = std::min(capacity, declared);
+    // a fresh buffer since reserve on a growing one may round its capacity 
+    // up past the declared size
+    Container next;
+    next.reserve(capacity);
+    next.assign(out.begin(), out.begin() + written);
+    next.resize(capacity);
+    out = std::move(next);
+}
+
+template <class Container>
+Result<> ZipReader::extractInto(Entry const& entry, Container& out) {
+    uint8_t header[LOCAL_HEADER_SIZE];
+    m_file.clear();
+    m_file.seekg(entry.localHeaderOffset);
+    m_file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!m_file || readLE<uint32_t>(header) != LOCAL_HEADER_SIGNATURE) {
+        return fail("Entry header is corrupted");
+    }
+    auto dataOffset = entry.localHeaderOffset + LOCAL_HEADER_SIZE +
+        readLE<uint16_t>(header + 26) + readLE<uint16_t>(header + 28);
+    if (dataOffset > m_fileSize || entry.compressed > m_fileSize - dataOffset) {
+        return fail("Entry data is out of bounds");
+    }
+    m_file.seekg(dataOffset);
+
+    switch (entry.method) {
+        case METHOD_STORE: {
+            if (entry.compressed != entry.uncompressed) {
+                return fail("Entry sizes don't match");
+            }
+            // the size was checked against the file above, so it's real
+            out.resize(entry.uncompressed);
+            m_file.read(reinterpret_cast<char*>(out.data()), entry.uncompressed);
+            if (!m_file) {
+                return fail("Unable to read entry");
+            }
+        } break;
+
+        case METHOD_DEFLATE: {
+            // anything that claims more than deflate can produce is forged
+            if (entry.uncompressed > saturatingMul(std::max<size_t>(entry.compressed, 1), MAX_DEFLATE_RATIO)) {
+                return fail(
+                    "Entry claims to decompress to ", entry.uncompressed, " bytes from ",
+                    entry.compressed, " bytes, which is more than deflate can produce"
+                );
+            }
+            z_stream stream {};
+            if (inflateInit2(&stream, -15) != Z_OK) {
+                return fail("Unable to initialize decompression");
+            }
+            // the compressed data is streamed from disk, so only the output
+            // has to fit in memory
+            ImportArena::Scope scope(m_arena);
+            ArenaVector<char> chunk(std::min<size_t>(entry.compressed, 64 * 1024), m_arena);
+            size_t readSoFar = 0;
+            size_t written = 0;
+            int status = Z_OK;
+            while (status != Z_STREAM_END) {
+                if (stream.avail_in == 0 && readSoFar < entry.compressed) {
+                    auto count = std::min(chunk.size(), entry.compressed - readSoFar);
+                    m_file.read(chunk.data(), count);
+                    if (!m_file) {
+                        inflateEnd(&stream);
+                        return fail("Unable to read entry");
+                    }
+                    readSoFar += count;
+                    stream.next_in = reinterpret_cast<Bytef*>(chunk.data());
+                    stream.avail_in = static_cast<uInt>(count);
+                }
+                // once the declared size is reached, anything more the stream
+                // produces ends up in this byte and means the entry lied
+                char overflow;
+                bool full = written == entry.uncompressed;
+                if (!full && written == out.size()) {
+                    growOutput(out, written, entry.compressed, entry.uncompressed);
+                }
+                stream.next_out = full ? reinterpret_cast<Bytef*>(&overflow) : reinterpret_cast<Bytef*>(out.data()) + written;
+                stream.avail_out = full ? 1 : static_cast<uInt>(std::min<size_t>(out.size() - written, UINT_MAX));
+                auto before = stream.avail_out;
+
+                status = inflate(&stream, Z_NO_FLUSH);
+                auto produced = before - stream.avail_out;
+                if (full && produced) {
+                    inflateEnd(&stream);
+                    return fail("Entry is larger than its declared size");
+                }
+                written += full ? 0 : produced;
+
+                if (status != Z_OK && status != Z_STREAM_END) {
+                    inflateEnd(&stream);
+                    return fail("Unable to decompress entry");
+                }
+                if (status == Z_OK && stream.avail_in == 0 && readSoFar == entry.compressed && !produced) {
+                    inflateEnd(&stream);
+                    return fail("Unable to decompress entry: unexpected end of data");
+                }
+            }
+            inflateEnd(&stream);
+            if (written != entry.uncompressed) {
+                return fail("Entry is smaller than its declared size");
+            }
+        } break;
+
+        default: {
+            return fail("Unsupported compression method ", entry.method);
+        } break;
+    }
+
+    if (crc32_z(0, reinterpret_cast<Bytef const*>(out.data()), entry.uncompressed) != entry.crc) {
+        return fail("Entry checksum doesn't match");
+    }
+    return {};
+}
+
+Result<std::string> ZipReader::extract(std::string_view name, size_t maxSize) {
+    auto entry = this->getEntry(name);
+    if (!entry) {
+        return fail("Entry '", name, "' not found");
+    }
+    if (entry->uncompressed > maxSize) {
+        return fail(
+            "Entry '", name, "' is ", entry->uncompressed,
+            " bytes, which is over the allowed ", maxSize, " bytes"
+        );
+    }
+    std::string res;
+    GMDCORE_UNWRAP(withContext(this->extractInto(*entry, res), name));
+    return res;
+}
+
+Result<ByteVector> ZipReader::extractBytes(std::string_view name, size_t maxSize) {
+    auto entry = this->getEntry(name);
+    if (!entry) {
+        return fail("Entry '", name, "' not found");
+    }
+    if (entry->uncompressed > maxSize) {
+        return fail(
+            "Entry '", name, "' is ", entry->uncompressed,
+            " bytes, which is over the allowed ", maxSize, " bytes"
+        );
+    }
+    ByteVector res;
+    GMDCORE_UNWRAP(withContext(this->extractInto(*entry, res), name));
+    return res;
+}
+
+ZipWriter::ZipWriter(int level) : m_level(level) {}
+
+Result<> ZipWriter::add(std::string_view name, std::string_view data) {
+    return this->addData(name, reinterpret_cast<uint8_t const*>(data.data()), data.size());
+}
+
+Result<> ZipWriter::add(std::string_view name, ByteVector const& data) {
+    return this->addData(name, data.data(), data.size());
+}
+
+Result<> ZipWriter::addData(std::string_view name, uint8_t const* data, size_t size) {
+    if (name.size() > 0xffff) {
+        return fail("Entry name is too long");
+    }
+    if (m_entries.size() >= 0xffff) {
+        return fail("Too many entries");
+    }
+    Entry entry {
+        .name = std::string(name),
+        .method = METHOD_STORE,
+        .crc = static_cast<uint32_t>(crc32_z(0, data, size)),
+        .compressed = size,
+        .uncompressed = size,
+        .localHeaderOffset = m_data.size(),
+    };
+
+    ByteVector compressed;
+    if (m_level != 0) {
+        GMDCORE_UNWRAP_INTO(compressed, deflateData(data, size, m_level, -15));
+        // not worth it if it doesn't even make the data smaller
+        if (compressed.size() < size) {
+            entry.method = METHOD_DEFLATE;
+            entry.compressed = compressed.size();
+        }
+    }
+    if (entry.uncompressed >= 0xffffffff || m_data.size() + entry.compressed >= 0xffffffff) {
+        return fail("Zip64 archives are not supported");
+    }
+
+    writeLE<uint32_t>(m_data, LOCAL_HEADER_SIGNATURE);
+    writeLE<uint16_t>(m_data, ZIP_VERSION);
+    writeLE<uint16_t>(m_data, ZIP_FLAGS);
+    writeLE<uint16_t>(m_data, entry.method);
+    writeLE<uint16_t>(m_data, ZIP_TIME);
+    writeLE<uint16_t>(m_data, ZIP_DATE);
+    writeLE<uint32_t>(m_data, entry.crc);
+    writeLE<uint32_t>(m_data, static_cast<uint32_t>(entry.compressed));
+    writeLE<uint32_t>(m_data, static_cast<uint32_t>(entry.uncompressed));
+    writeLE<uint16_t>(m_data, static_cast<uint16_t>(name.size()));
+    writeLE<uint16_t>(m_data, 0);
+    m_data.insert(m_data.end(), name.begin(), name.end());
+    if (entry.method == METHOD_DEFLATE) {
+        m_data.insert(m_data.end(), compressed.begin(), compressed.end());
+    }
+    else {
+        m_data.insert(m_data.end(), data, data + size);
+    }
+
+    m_entries.push_back(std::move(entry));
+    return {};
+}
+
+Result<ByteVector> ZipWriter::finish() && {
+    auto cdOffset = m_data.size();
+    for (auto& entry : m_entries) {
+        writeLE<uint32_t>(m_data, CD_ENTRY_SIGNATURE);
+        writeLE<uint16_t>(m_data, ZIP_VERSION);
+        writeLE<uint16_t>(m_data, ZIP_VERSION);
+        writeLE<uint16_t>(m_data, ZIP_FLAGS);
+        writeLE<uint16_t>(m_data, entry.method);
+        writeLE<uint16_t>(m_data, ZIP_TIME);
+        writeLE<uint16_t>(m_data, ZIP_DATE);
+        writeLE<uint32_t>(m_data, entry.crc);
+        writeLE<uint32_t>(m_data, static_cast<uint32_t>(entry.compressed));
+        writeLE<uint32_t>(m_data, static_cast<uint32_t>(entry.uncompressed));
+        writeLE<uint16_t>(m_data, static_cast<uint16_t>(entry.name.size()));
+        // extra field, comment, disk number, internal & external attributes
+        writeLE<uint16_t>(m_data, 0);
+        writeLE<uint16_t>(m_data, 0);
+        writeLE<uint16_t>(m_data, 0);
+        writeLE<uint16_t>(m_data, 0);
+        writeLE<uint32_t>(m_data, 0);
+        writeLE<uint32_t>(m_data, static_cast<uint32_t>(entry.localHeaderOffset));
+        m_data.insert(m_data.end(), entry.name.begin(), entry.name.end());
+    }
+    auto cdSize = m_data.size() - cdOffset;
+    if (m_data.size() >= 0xffffffff) {
+        return fail("Zip64 archives are not supported");
+    }
+
+    writeLE<uint32_t>(m_data, EOCD_SIGNATURE);
+    // disk numbers
+    writeLE<uint16_t>(m_data, 0);
+    writeLE<uint16_t>(m_data, 0);
+    writeLE<uint16_t>(m_data, static_cast<uint16_t>(m_entries.size()));
+    writeLE<uint16_t>(m_data, static_cast<uint16_t>(m_entries.size()));
+    writeLE<uint32_t>(m_data, static_cast<uint32_t>(cdSize));
+    writeLE<uint32_t>(m_data, static_cast<uint32_t>(cdOffset));
+    // comment
+    writeLE<uint16_t>(m_data, 0);
+
+    return std::move(m_data);
+}
@@ -0,0 +1,378 @@
+#include <GMDCore.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <zlib.h>
+
+using namespace gmd::core;
+namespace fs = std::filesystem;
+
+// track the largest single allocation, so tests can check that hostile
+// inputs are rejected before anything big is allocated
+static std::atomic<size_t> s_largestAllocation = 0;
+
+void* operator new(size_t size) {
+    auto largest = s_largestAllocation.load(std::memory_order_relaxed);
+    while (size > largest && !s_largestAllocation.compare_exchange_weak(largest, size, std::memory_order_relaxed)) {}
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static size_t s_failures = 0;
+
+#define CHECK(...) do {                                                         \
+        if (!(__VA_ARGS__)) {                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "     \
+                << #__VA_ARGS__ << "\n";                                        \
+            s_failures += 1;                                                    \
+        }                                                                       \
+    } while (false)
+
+// checks that a result is an error whose message contains `part`
+#define CHECK_ERROR(res, part) do {                                             \
+        auto&& res_ = (res);                                                    \
+        if (res_) {                                                             \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected an error "  \
+                << "containing '" << (part) << "'\n";                           \
+            s_failures += 1;                                                    \
+        }                                                                       \
+        else if (res_.error().find(part) == std::string::npos) {               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected an error "  \
+                << "containing '" << (part) << "', got '" << res_.error()       \
+                << "'\n";                                                       \
+            s_failures += 1;                                                    \
+        }                                                                       \
+    } while (false)
+
+static fs::path s_tempDir;
+
+static fs::path writeTemp(std::string const& name, ByteVector const& data) {
+    auto path = s_tempDir / name;
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return path;
+}
+
+static std::string sampleLevel() {
+    std::string data =
+        "<?xml version=\"1.0\"?><plist version=\"1.0\" gjver=\"2.0\"><dict>"
+        "<k>kCEK</k><i>4</i><k>k2</k><s>Test</s><k>k4</k><s>";
+    // something that compresses, but not to nothing
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < 20000; i += 1) {
+        data += static_cast<char>('A' + rng() % 8);
+    }
+    data += "</s></dict></plist>";
+    return data;
+}
+
+static ReadOptions withMemoryLimit(size_t limit) {
+    ReadOptions options;
+    options.memoryLimit = limit;
+    return options;
+}
+
+static ReadOptions withInflateRatio(size_t ratio) {
+    ReadOptions options;
+    options.maxInflateRatio = ratio;
+    return options;
+}
+
+static ByteVector gmd2WithStoredData() {
+    LevelFile file;
+    file.data = sampleLevel();
+    // level 0 stores entries as-is, so their bytes can be found in the file
+    auto res = writeLevelFile(file, LevelFormat::Gmd2, { .compressionLevel = 0 });
+    CHECK(res.has_value());
+    return res.value_or(ByteVector());
+}
+
+/**
+ * Find the central directory entry of `name` in a zip built by ZipWriter
+ */
+static size_t findDirectoryEntry(ByteVector const& zip, std::string_view name) {
+    for (size_t i = 0; i + 46 + name.size() <= zip.size(); i += 1) {
+        if (zip[i] == 'P' && zip[i + 1] == 'K' && zip[i + 2] == 1 && zip[i + 3] == 2 &&
+            std::string_view(reinterpret_cast<char const*>(zip.data() + i + 46), name.size()) == name
+        ) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+static void writeU32(ByteVector& data, size_t offset, uint32_t value) {
+    for (size_t i = 0; i < 4; i += 1) {
+        data[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+static ByteVector gzip(std::string_view data) {
+    z_stream stream {};
+    // 15 + 16 = GZip header
+    deflateInit2(&stream, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    ByteVector out(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static void testLvlRoundTrip() {
+    LevelFile file;
+    file.data = sampleLevel();
+    auto bytes = writeLevelFile(file, LevelFormat::Lvl, {});
+    CHECK(bytes.has_value());
+    if (!bytes) return;
+
+    auto read = readLevelFile(writeTemp("round.lvl", *bytes), LevelFormat::Lvl, {});
+    CHECK(read.has_value() && read->data == file.data);
+
+    // the game reads Lvl files with ZipUtils, so they have to be plain Zlib
+    std::string inflated(file.data.size(), '\0');
+    uLongf size = static_cast<uLongf>(inflated.size());
+    CHECK(uncompress(
+        reinterpret_cast<Bytef*>(inflated.data()), &size, bytes->data(), static_cast<uLong>(bytes->size())
+    ) == Z_OK);
+    CHECK(size == file.data.size() && inflated == file.data);
+
+    // GZip files from older versions are still accepted
+    auto gz = readLevelFile(writeTemp("round-gzip.lvl", gzip(file.data)), LevelFormat::Lvl, {});
+    CHECK(gz.has_value() && gz->data == file.data);
+}
+
+static void testGmdRoundTrip() {
+    LevelFile file;
+    file.data = sampleLevel();
+    auto bytes = writeLevelFile(file, LevelFormat::Gmd, {});
+    CHECK(bytes.has_value());
+    if (!bytes) return;
+    auto read = readLevelFile(writeTemp("round.gmd", *bytes), LevelFormat::Gmd, {});
+    CHECK(read.has_value() && read->data == file.data);
+}
+
+static void testGmd2RoundTrip() {
+    LevelFile file;
+    file.data = sampleLevel();
+    file.meta = R"({"song-file":"123.mp3","song-is-custom":true})";
+    file.extras.emplace_back("123.mp3", ByteVector { 1, 2, 3, 4, 5 });
+    file.extras.emplace_back("other.bin", ByteVector(1000, 7));
+    auto bytes = writeLevelFile(file, LevelFormat::Gmd2, {});
+    CHECK(bytes.has_value());
+    if (!bytes) return;
+    auto path = writeTemp("round.gmd2", *bytes);
+
+    // nothing but the metadata and level data unless asked for
+    auto plain = readLevelFile(path, LevelFormat::Gmd2, {});
+    CHECK(plain.has_value() && plain->data == file.data && plain->meta == file.meta && plain->extras.empty());
+
+    // only the selected entries are extracted, after the metadata is known
+    ImportArena arena;
+    ReadOptions options;
+    options.arena = &arena;
+    std::vector<std::string> offered;
+    options.selectExtras = [&](std::string_view meta, std::span<ExtraEntry> entries) {
+        CHECK(meta == file.meta);
+        for (auto& entry : entries) {
+            offered.emplace_back(entry.name);
+            entry.extract = entry.name == "123.mp3";
+        }
+        return Result<>();
+    };
+    auto selected = readLevelFile(path, LevelFormat::Gmd2, options);
+    CHECK(selected.has_value());
+    if (!selected) return;
+    CHECK(selected->data == file.data);
+    CHECK(std::ranges::is_permutation(offered, std::vector<std::string> { "123.mp3", "other.bin" }));
+    CHECK(selected->extras.size() == 1 && selected->extras[0] == file.extras[0]);
+
+    // the same without an arena
+    offered.clear();
+    options.arena = nullptr;
+    auto heap = readLevelFile(path, LevelFormat::Gmd2, options);
+    CHECK(heap.has_value() && heap->data == file.data && heap->extras == selected->extras);
+
+    // the callback can refuse the file
+    options.selectExtras = [](std::string_view, std::span<ExtraEntry>) {
+        return Result<>(std::unexpected("bad song name"));
+    };
+    CHECK_ERROR(readLevelFile(path, LevelFormat::Gmd2, options), "bad song name");
+}
+
+static void testGmdlRoundTrip() {
+    std::string list =
+        "<?xml version=\"1.0\"?><plist version=\"1.0\" gjver=\"2.0\"><dict>"
+        "<k>k1</k><i>1</i></dict></plist>";
+    auto bytes = writeListFile(list, ListFormat::Gmdl, {});
+    CHECK(bytes.has_value());
+    if (!bytes) return;
+    auto read = readListFile(writeTemp("round.gmdl", *bytes), ListFormat::Gmdl, {});
+    CHECK(read.has_value() && *read == list);
+}
+
+static void testCrcMismatch() {
+    auto zip = gmd2WithStoredData();
+    auto level = sampleLevel();
+    auto it = std::ranges::search(zip, level).begin();
+    CHECK(it != zip.end());
+    if (it == zip.end()) return;
+    // same size, different content
+    it[level.size() / 2] ^= 1;
+    CHECK_ERROR(readLevelFile(writeTemp("crc.gmd2", zip), LevelFormat::Gmd2, {}), "checksum");
+}
+
+static void testDeclaredSizeMismatch() {
+    LevelFile file;
+    file.data = sampleLevel();
+    auto zip = writeLevelFile(file, LevelFormat::Gmd2, {}).value_or(ByteVector());
+    auto entry = findDirectoryEntry(zip, "level.data");
+    CHECK(entry != SIZE_MAX);
+    if (entry == SIZE_MAX) return;
+
+    auto smaller = zip;
+    writeU32(smaller, entry + 24, static_cast<uint32_t>(file.data.size() - 1));
+    CHECK_ERROR(readLevelFile(writeTemp("size-smaller.gmd2", smaller), LevelFormat::Gmd2, {}), "larger than its declared size");
+
+    auto larger = zip;
+    writeU32(larger, entry + 24, static_cast<uint32_t>(file.data.size() + 1));
+    CHECK_ERROR(readLevelFile(writeTemp("size-larger.gmd2", larger), LevelFormat::Gmd2, {}), "smaller than its declared size");
+
+    // a declared size over the limit is rejected without extracting
+    auto huge = zip;
+    writeU32(huge, entry + 24, 0xfffffffe);
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(writeTemp("size-huge.gmd2", huge), LevelFormat::Gmd2, withMemoryLimit(1024 * 1024)), "memory limit");
+    CHECK(s_largestAllocation < 1024 * 1024);
+}
+
+static void testZip64Rejected() {
+    auto zip = gmd2WithStoredData();
+    // the end of central directory record is the last 22 bytes, as
+    // ZipWriter doesn't write a comment; 0xffff entries means Zip64
+    zip[zip.size() - 22 + 10] = 0xff;
+    zip[zip.size() - 22 + 11] = 0xff;
+    CHECK_ERROR(readLevelFile(writeTemp("zip64.gmd2", zip), LevelFormat::Gmd2, {}), "Zip64");
+}
+
+static void testDirectoryBudget() {
+    // a large central directory counts against the memory limit
+    LevelFile file;
+    file.data = sampleLevel();
+    for (size_t i = 0; i < 2000; i += 1) {
+        file.extras.emplace_back("packaged/file-with-a-rather-long-name-" + std::to_string(i), ByteVector(1));
+    }
+    auto zip = writeLevelFile(file, LevelFormat::Gmd2, {}).value_or(ByteVector());
+    auto path = writeTemp("large-directory.gmd2", zip);
+    CHECK_ERROR(readLevelFile(path, LevelFormat::Gmd2, withMemoryLimit(128 * 1024)), "zip directory");
+    CHECK(readLevelFile(path, LevelFormat::Gmd2, withMemoryLimit(1024 * 1024)).has_value());
+
+    // more entries than the directory has room for
+    auto forged = gmd2WithStoredData();
+    forged[forged.size() - 22 + 10] = 0xfe;
+    forged[forged.size() - 22 + 11] = 0xff;
+    CHECK_ERROR(readLevelFile(writeTemp("count.gmd2", forged), LevelFormat::Gmd2, {}), "too small");
+}
+
+static void testForgedTrailer() {
+    // GZip stores the uncompressed size in its trailer; claiming 4 GB must
+    // not make the reader allocate anything near that
+    auto gz = gzip(sampleLevel());
+    writeU32(gz, gz.size() - 4, 0xffffffff);
+    s_largestAllocation = 0;
+    CHECK(!readLevelFile(writeTemp("forged.lvl", gz), LevelFormat::Lvl, {}).has_value());
+    CHECK(s_largestAllocation < 1024 * 1024);
+}
+
+static void testForgedEntrySize() {
+    // the same for zip entries, whose sizes come from the central directory
+    LevelFile file;
+    file.data = sampleLevel();
+    auto zip = writeLevelFile(file, LevelFormat::Gmd2, {}).value_or(ByteVector());
+    auto entry = findDirectoryEntry(zip, "level.data");
+    CHECK(entry != SIZE_MAX);
+    if (entry == SIZE_MAX) return;
+    size_t compressed = zip[entry + 20] | (zip[entry + 21] << 8) | (zip[entry + 22] << 16);
+
+    // more than deflate could ever produce from the compressed size
+    auto forged = zip;
+    writeU32(forged, entry + 24, 0xfffffff0);
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(writeTemp("forged-huge.gmd2", forged), LevelFormat::Gmd2, {}), "more than deflate can produce");
+    CHECK(s_largestAllocation < 1024 * 1024);
+
+    // plausible, but still far more than the real data
+    auto plausible = zip;
+    writeU32(plausible, entry + 24, static_cast<uint32_t>(compressed * 1000));
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(writeTemp("forged-plausible.gmd2", plausible), LevelFormat::Gmd2, {}), "smaller than its declared size");
+    CHECK(s_largestAllocation < 1024 * 1024);
+}
+
+static void testInflateBomb() {
+    auto gz = gzip(std::string(64 * 1024 * 1024, '\0'));
+    auto path = writeTemp("bomb.lvl", gz);
+    constexpr size_t LIMIT = 8 * 1024 * 1024;
+
+    // strings allocate one more byte for the terminator
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(path, LevelFormat::Lvl, withMemoryLimit(LIMIT)), "larger than the allowed");
+    CHECK(s_largestAllocation <= LIMIT + 1);
+
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(path, LevelFormat::Lvl, withInflateRatio(100)), "larger than the allowed");
+    CHECK(s_largestAllocation <= gz.size() * 100 + 1);
+
+    // the same in a Gmd2 file is caught from the declared sizes alone
+    LevelFile file;
+    file.data = std::string(64 * 1024 * 1024, '\0');
+    auto zip = writeLevelFile(file, LevelFormat::Gmd2, {}).value_or(ByteVector());
+    file.data.clear();
+    file.data.shrink_to_fit();
+    auto zipPath = writeTemp("bomb.gmd2", zip);
+    s_largestAllocation = 0;
+    CHECK_ERROR(readLevelFile(zipPath, LevelFormat::Gmd2, withMemoryLimit(LIMIT)), "memory limit");
+    CHECK_ERROR(readLevelFile(zipPath, LevelFormat::Gmd2, withInflateRatio(100)), "allowed ratio");
+    CHECK(s_largestAllocation < 1024 * 1024);
+}
+
+int main() {
+    s_tempDir = fs::temp_directory_path() / ("gmd-core-tests-" + std::to_string(std::random_device()()));
+    fs::create_directories(s_tempDir);
+
+    testLvlRoundTrip();
+    testGmdRoundTrip();
+    testGmd2RoundTrip();
+    testGmdlRoundTrip();
+    testCrcMismatch();
+    testDeclaredSizeMismatch();
+    testZip64Rejected();
+    testDirectoryBudget();
+    testForgedTrailer();
+    testForgedEntrySize();
+    testInflateBomb();
+
+    std::error_code ec;
+    fs::remove_all(s_tempDir, ec);
+
+    if (s_failures) {
+        std::cerr << s_failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
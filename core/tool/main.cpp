@@ -0,0 +1,610 @@
+#include <GMDCore.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+
+using namespace gmd::core;
+namespace fs = std::filesystem;
+
+// count heap allocations for the bench command
+static std::atomic<size_t> s_allocations = 0;
+static std::atomic<size_t> s_allocatedBytes = 0;
+
+void* operator new(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+// over-aligned allocations go through these. MSVC has no std::aligned_alloc
+// and its aligned blocks have to be freed with _aligned_free
+static void* alignedMalloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+static void alignedFree(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+void* operator new(size_t size, std::align_val_t align) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto ptr = alignedMalloc(std::max<size_t>(size, 1), static_cast<size_t>(align))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    alignedFree(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    alignedFree(ptr);
+}
+
+constexpr auto USAGE = R"(Usage: gmdtool <command> [options] <paths...>
+
+Commands:
+  convert <input> <output>      Convert level files to another format
+  recompress <input> <output>   Rewrite files in their own format with a new
+                                compression level
+  validate <input>...           Check that files can be read and parsed
+  bench <input>...              Report the heap allocations of reading each
+                                file without and with an import arena
+
+Inputs can be files or directories, which are searched recursively for level
+(.lvl, .gmd, .gmd2) and list (.gmdl) files. The output of convert and
+recompress is a directory that mirrors the input tree, or a file if the input
+is a single file and the output has a known extension, which has to match the
+format being written. Inputs that would be written to the same output, like
+a.lvl and a.gmd, are rejected.
+
+Options:
+  -t, --to <lvl|gmd|gmd2>       Level format to convert to (default: gmd2)
+  -j, --jobs <n>                Files to process in parallel (default: number
+                                of hardware threads)
+  -l, --level <0-9>             Compression level for Lvl and Gmd2 (default: 6)
+      --memory-limit <bytes>    Per-file memory limit; accepts k/m/g suffixes
+      --max-inflate-ratio <n>   Reject compressed data that inflates more than
+                                n times its size
+      --overwrite               Replace output files that already exist;
+                                otherwise they're skipped and the run fails
+)";
+
+enum class Command {
+    Convert,
+    Recompress,
+    Validate,
+    Bench,
+};
+
+struct Options {
+    Command command;
+    std::vector<fs::path> inputs;
+    std::optional<fs::path> output;
+    std::optional<LevelFormat> to;
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    WriteOptions write;
+    ReadOptions read;
+    bool overwrite = false;
+};
+
+struct Job {
+    fs::path input;
+    fs::path output;
+};
+
+/**
+ * A level or list file type, as detected from a file's extension
+ */
+struct FileType {
+    std::optional<LevelFormat> level;
+    std::optional<ListFormat> list;
+
+    static std::optional<FileType> from(fs::path const& path) {
+        auto ext = extensionWithoutDot(path);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (auto level = levelFormatFromString(ext)) {
+            return FileType { level, std::nullopt };
+        }
+        if (auto list = listFormatFromString(ext)) {
+            return FileType { std::nullopt, list };
+        }
+        return std::nullopt;
+    }
+};
+
+template <class T>
+static Result<T> parseNumber(std::string_view str, std::string_view what) {
+    T value {};
+    auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::unexpected("Invalid " + std::string(what) + " '" + std::string(str) + "'");
+    }
+    return value;
+}
+
+static Result<size_t> parseSize(std::string_view str) {
+    size_t multiplier = 1;
+    if (str.size()) {
+        switch (std::tolower(static_cast<unsigned char>(str.back()))) {
+            case 'k': multiplier = 1024; break;
+            case 'm': multiplier = 1024 * 1024; break;
+            case 'g': multiplier = 1024 * 1024 * 1024; break;
+        }
+        if (multiplier != 1) {
+            str.remove_suffix(1);
+        }
+    }
+    auto value = parseNumber<size_t>(str, "memory limit");
+    if (!value) {
+        return value;
+    }
+    return saturatingMul(*value, multiplier);
+}
+
+static Result<Options> parseArgs(int argc, char** argv) {
+    if (argc < 2) {
+        return std::unexpected("No command given");
+    }
+    Options options;
+    std::string_view command = argv[1];
+    if (command == "convert")         options.command = Command::Convert;
+    else if (command == "recompress") options.command = Command::Recompress;
+    else if (command == "validate")   options.command = Command::Validate;
+    else if (command == "bench")      options.command = Command::Bench;
+    else return std::unexpected("Unknown command '" + std::string(command) + "'");
+
+    std::vector<std::string_view> positional;
+    for (int i = 2; i < argc; i += 1) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> Result<std::string_view> {
+            if (i + 1 >= argc) {
+                return std::unexpected("Option " + std::string(arg) + " expects a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "-t" || arg == "--to") {
+            auto to = value();
+            if (!to) return std::unexpected(to.error());
+            options.to = levelFormatFromString(*to);
+            if (!options.to) {
+                return std::unexpected("Unknown level format '" + std::string(*to) + "'");
+            }
+        }
+        else if (arg == "-j" || arg == "--jobs") {
+            auto str = value();
+            if (!str) return std::unexpected(str.error());
+            auto jobs = parseNumber<size_t>(*str, "job count");
+            if (!jobs) return std::unexpected(jobs.error());
+            options.jobs = std::max<size_t>(*jobs, 1);
+        }
+        else if (arg == "-l" || arg == "--level") {
+            auto str = value();
+            if (!str) return std::unexpected(str.error());
+            auto level = parseNumber<int>(*str, "compression level");
+            if (!level) return std::unexpected(level.error());
+            if (*level < 0 || *level > 9) {
+                return std::unexpected("Compression level must be between 0 and 9");
+            }
+            options.write.compressionLevel = *level;
+        }
+        else if (arg == "--memory-limit") {
+            auto str = value();
+            if (!str) return std::unexpected(str.error());
+            auto limit = parseSize(*str);
+            if (!limit) return std::unexpected(limit.error());
+            options.read.memoryLimit = *limit;
+        }
+        else if (arg == "--max-inflate-ratio") {
+            auto str = value();
+            if (!str) return std::unexpected(str.error());
+            auto ratio = parseNumber<size_t>(*str, "inflate ratio");
+            if (!ratio) return std::unexpected(ratio.error());
+            options.read.maxInflateRatio = *ratio;
+        }
+        else if (arg == "--overwrite") {
+            options.overwrite = true;
+        }
+        else if (arg.starts_with('-') && arg.size() > 1) {
+            return std::unexpected("Unknown option '" + std::string(arg) + "'");
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+
+    switch (options.command) {
+        case Command::Convert: case Command::Recompress: {
+            if (positional.size() != 2) {
+                return std::unexpected(std::string(command) + " expects an input and an output");
+            }
+            options.inputs.push_back(positional[0]);
+            options.output = positional[1];
+        } break;
+
+        case Command::Validate: case Command::Bench: {
+            if (positional.empty()) {
+                return std::unexpected(std::string(command) + " expects at least one input");
+            }
+            options.inputs.assign(positional.begin(), positional.end());
+        } break;
+    }
+    if (options.command != Command::Convert && options.to) {
+        return std::unexpected("--to is only supported by convert");
+    }
+    return options;
+}
+
+static fs::path outputPathFor(fs::path path, Options const& options) {
+    auto type = FileType::from(path);
+    if (options.command == Command::Convert && type && type->level) {
+        path.replace_extension(levelFormatToString(options.to.value_or(LevelFormat::Gmd2)));
+    }
+    return path;
+}
+
+static Result<std::vector<Job>> collectJobs(Options& options) {
+    std::vector<Job> jobs;
+    for (auto& input : options.inputs) {
+        std::error_code ec;
+        if (fs::is_directory(input, ec)) {
+            for (auto it = fs::recursive_directory_iterator(input, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                std::error_code entryEc;
+                if (!it->is_regular_file(entryEc) || !FileType::from(it->path())) {
+                    if (entryEc) {
+                        return std::unexpected("Unable to read " + it->path().string() + ": " + entryEc.message());
+                    }
+                    continue;
+                }
+                Job job { it->path(), {} };
+                if (options.output) {
+                    auto relative = fs::relative(it->path(), input, entryEc);
+                    if (entryEc) {
+                        return std::unexpected("Unable to read " + it->path().string() + ": " + entryEc.message());
+                    }
+                    job.output = *options.output / outputPathFor(relative, options);
+                }
+                jobs.push_back(std::move(job));
+            }
+            if (ec) {
+                return std::unexpected("Unable to read directory " + input.string() + ": " + ec.message());
+            }
+        }
+        else if (fs::is_regular_file(input, ec)) {
+            auto type = FileType::from(input);
+            if (!type) {
+                return std::unexpected("Unknown file type for " + input.string());
+            }
+            Job job { input, {} };
+            if (options.output) {
+                // a single file can be converted into a file directly, in which
+                // case the target format comes from the output's extension
+                // unless --to is given
+                auto outType = FileType::from(*options.output);
+                if (outType && !fs::is_directory(*options.output, ec)) {
+                    if (options.command == Command::Convert && type->level && outType->level && !options.to) {
+                        options.to = outType->level;
+                    }
+                    // the extension has to match what's actually written, or
+                    // the file would be read back as the wrong format
+                    auto written = *type;
+                    if (options.command == Command::Convert && written.level) {
+                        written.level = options.to.value_or(LevelFormat::Gmd2);
+                    }
+                    if (written.level != outType->level || written.list != outType->list) {
+                        return std::unexpected(
+                            "Output " + options.output->string() + " doesn't have the extension of the ." +
+                            (written.level ? levelFormatToString(*written.level) : listFormatToString(*written.list)) +
+                            " file being written"
+                        );
+                    }
+                    job.output = *options.output;
+                }
+                else {
+                    job.output = *options.output / outputPathFor(input.filename(), options);
+                }
+            }
+            jobs.push_back(std::move(job));
+        }
+        else {
+            return std::unexpected("Unable to find " + input.string());
+        }
+    }
+
+    // different inputs can map to the same output, like a.lvl and a.gmd
+    // both converting to a.gmd2, in which case one would silently replace
+    // the other
+    std::map<fs::path, fs::path const*> outputs;
+    for (auto& job : jobs) {
+        if (job.output.empty()) {
+            continue;
+        }
+        auto [it, inserted] = outputs.emplace(job.output.lexically_normal(), &job.input);
+        if (!inserted) {
+            return std::unexpected(
+                "Both " + it->second->string() + " and " + job.input.string() +
+                " would be written to " + job.output.string()
+            );
+        }
+    }
+    return jobs;
+}
+
+static Result<> writeOutput(fs::path const& path, ByteVector const& data) {
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+        if (ec) {
+            return std::unexpected("Unable to create " + path.parent_path().string() + ": " + ec.message());
+        }
+    }
+    // write next to the target first so an interrupted run never leaves a
+    // half-written file in place of a good one. The name is unique so other
+    // writes, even from other runs, can't clobber it
+    static auto const runId = std::random_device()();
+    static std::atomic<size_t> tempCount = 0;
+    auto temp = path;
+    temp += "." + std::to_string(runId) + "-" + std::to_string(tempCount++) + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary);
+        file.write(reinterpret_cast<char const*>(data.data()), data.size());
+        // closed before removing, since Windows can't remove open files
+        file.close();
+        if (!file) {
+            fs::remove(temp, ec);
+            return std::unexpected("Unable to write " + path.string());
+        }
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return std::unexpected("Unable to write " + path.string());
+    }
+    return {};
+}
+
+struct JobResult {
+    /**
+     * Whether the file was skipped instead of processed
+     */
+    bool skipped = false;
+    /**
+     * A note to print alongside the result, if any
+     */
+    std::string note;
+};
+
+/**
+ * Process one file
+ */
+static Result<JobResult> runJob(Job const& job, Options const& options) {
+    auto type = *FileType::from(job.input);
+
+    if (options.command == Command::Validate || options.command == Command::Bench) {
+        // normalizing may copy the data once
+        auto read = options.read;
+        read.parseCostFactor = 2;
+
+        std::string data;
+        if (type.level) {
+            auto file = readLevelFile(job.input, *type.level, read);
+            if (!file) return std::unexpected(file.error());
+            data = std::move(file->data);
+        }
+        else {
+            auto file = readListFile(job.input, *type.list, read);
+            if (!file) return std::unexpected(file.error());
+            data = std::move(*file);
+        }
+        auto isOldFile = normalizePlist(data);
+        if (auto res = validatePlist(data); !res) {
+            return std::unexpected(res.error());
+        }
+        // the level string has always been stored under k4
+        if (type.level && data.find("<k>k4</k>") == std::string::npos) {
+            return std::unexpected("Level has no level string (k4)");
+        }
+        return JobResult { false, isOldFile ? "old GDShare file" : "" };
+    }
+
+    if (!options.overwrite) {
+        std::error_code ec;
+        if (fs::exists(job.output, ec)) {
+            return JobResult { true, "output already exists, use --overwrite to replace it" };
+        }
+        if (ec) {
+            return std::unexpected("Unable to check " + job.output.string() + ": " + ec.message());
+        }
+    }
+
+    ByteVector out;
+    std::string note;
+    if (type.level) {
+        auto to = options.command == Command::Convert ?
+            options.to.value_or(LevelFormat::Gmd2) :
+            *type.level;
+
+        // packaged files can only be stored in Gmd2 files
+        bool hasExtras = false;
+        auto read = options.read;
+        read.selectExtras = [&](std::string_view, std::span<ExtraEntry> entries) {
+            hasExtras = entries.size();
+            for (auto& entry : entries) {
+                entry.extract = to == LevelFormat::Gmd2;
+            }
+            return Result<>();
+        };
+        auto file = readLevelFile(job.input, *type.level, read);
+        if (!file) return std::unexpected(file.error());
+        if (to != LevelFormat::Gmd2 && (file->meta != "{}" || hasExtras)) {
+            note = "metadata and packaged files dropped";
+        }
+
+        auto res = writeLevelFile(*file, to, options.write);
+        if (!res) return std::unexpected(res.error());
+        out = std::move(*res);
+    }
+    else {
+        auto file = readListFile(job.input, *type.list, options.read);
+        if (!file) return std::unexpected(file.error());
+
+        auto res = writeListFile(*file, *type.list, options.write);
+        if (!res) return std::unexpected(res.error());
+        out = std::move(*res);
+    }
+    if (auto res = writeOutput(job.output, out); !res) {
+        return std::unexpected(res.error());
+    }
+    return JobResult { false, note };
+}
+
+/**
+ * Process one file, turning exceptions like std::bad_alloc into errors so
+ * they can't escape a worker thread and terminate the whole run
+ */
+static Result<JobResult> tryRunJob(Job const& job, Options const& options) {
+    try {
+        return runJob(job, options);
+    }
+    catch (std::exception const& e) {
+        return std::unexpected(std::string(e.what()));
+    }
+}
+
+static int runJobs(std::vector<Job> const& jobs, Options const& options) {
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> failed = 0;
+    std::atomic<size_t> skipped = 0;
+    std::mutex outputLock;
+
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+            auto& job = jobs[i];
+            auto res = tryRunJob(job, options);
+
+            std::lock_guard lock(outputLock);
+            if (!res) {
+                failed += 1;
+                std::cerr << "[error] " << job.input.string() << ": " << res.error() << "\n";
+                continue;
+            }
+            if (res->skipped) {
+                skipped += 1;
+                std::cerr << "[skipped] " << job.input.string() << ": " << res->note << "\n";
+                continue;
+            }
+            std::cout << "[ok] " << job.input.string();
+            if (!job.output.empty()) {
+                std::cout << " -> " << job.output.string();
+            }
+            if (res->note.size()) {
+                std::cout << " (" << res->note << ")";
+            }
+            std::cout << "\n";
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < std::min(options.jobs, jobs.size()); i += 1) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    threads.clear();
+
+    std::cout << jobs.size() - failed - skipped << " of " << jobs.size() << " files succeeded";
+    if (skipped) {
+        std::cout << ", " << skipped << " skipped";
+    }
+    std::cout << "\n";
+    return failed || skipped ? 1 : 0;
+}
+
+static int runBench(std::vector<Job> const& jobs, Options const& options) {
+    struct Counts {
+        size_t allocations;
+        size_t bytes;
+    };
+    auto measure = [&](Job const& job, ImportArena* arena) -> Result<Counts> {
+        // copied before counting so it doesn't show up in the results
+        auto benchOptions = options;
+        benchOptions.read.arena = arena;
+        auto allocations = s_allocations.load();
+        auto bytes = s_allocatedBytes.load();
+        auto res = tryRunJob(job, benchOptions);
+        if (!res) return std::unexpected(res.error());
+        return Counts { s_allocations.load() - allocations, s_allocatedBytes.load() - bytes };
+    };
+
+    // bench runs one file at a time, since the counters are global
+    size_t failed = 0;
+    Counts totalBefore {}, totalAfter {};
+    for (auto& job : jobs) {
+        // without an arena the zip directory, read buffers and entry lists
+        // all go through the heap, which is how reading worked before it
+        auto before = measure(job, nullptr);
+        if (!before) {
+            failed += 1;
+            std::cerr << "[error] " << job.input.string() << ": " << before.error() << "\n";
+            continue;
+        }
+        // the arena itself lives outside the measured region, like it does in
+        // the mod where it's on the stack
+        ImportArena arena;
+        auto after = measure(job, &arena);
+        if (!after) {
+            failed += 1;
+            std::cerr << "[error] " << job.input.string() << ": " << after.error() << "\n";
+            continue;
+        }
+        std::cout << job.input.string() << ": "
+            << before->allocations << " -> " << after->allocations << " allocations, "
+            << before->bytes << " -> " << after->bytes << " bytes\n";
+        totalBefore.allocations += before->allocations;
+        totalBefore.bytes += before->bytes;
+        totalAfter.allocations += after->allocations;
+        totalAfter.bytes += after->bytes;
+    }
+    std::cout << "total: "
+        << totalBefore.allocations << " -> " << totalAfter.allocations << " allocations, "
+        << totalBefore.bytes << " -> " << totalAfter.bytes << " bytes\n";
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    auto options = parseArgs(argc, argv);
+    if (!options) {
+        std::cerr << "gmdtool: " << options.error() << "\n\n" << USAGE;
+        return 2;
+    }
+    auto jobs = collectJobs(*options);
+    if (!jobs) {
+        std::cerr << "gmdtool: " << jobs.error() << "\n";
+        return 2;
+    }
+    if (options->command == Command::Bench) {
+        return runBench(*jobs, *options);
+    }
+    return runJobs(*jobs, *options);
+}
@@ -107,6 +107,10 @@ namespace gmd {
      * Class for working with importing levels as GMD files
      */
     class GMDAPI_DLL ImportGmdFile : public IGmdFile<ImportGmdFile> {
+    private:
+        class Impl;
+        std::unique_ptr<Impl> m_impl;
+
     protected:
         std::filesystem::path m_path;
         bool m_importSong = false;
@@ -116,6 +120,12 @@ namespace gmd {
         geode::Result<std::string> getLevelData() const;
 
     public:
+        ImportGmdFile(ImportGmdFile const& other);
+        ImportGmdFile(ImportGmdFile&& other) noexcept;
+        ImportGmdFile& operator=(ImportGmdFile const& other);
+        ImportGmdFile& operator=(ImportGmdFile&& other) noexcept;
+        ~ImportGmdFile();
+
         /**
          * Create an ImportGmdFile instance from a file
          * @param path The file to import
@@ -135,6 +145,20 @@ namespace gmd {
          * Set whether to import the song file included in this file or not
          */
         ImportGmdFile& setImportSong(bool song);
+        /**
+         * Set an upper bound (in bytes) for the memory used at once while 
+         * importing the file. The import fails with an error before 
+         * allocating anything that would go over the limit
+         * @note By default there is no limit. The limit covers the file data 
+         * and its parsed form, not the resulting GJGameLevel's other fields
+         */
+        ImportGmdFile& setMemoryLimit(std::optional<size_t> bytes);
+        /**
+         * Set the maximum ratio between the decompressed and compressed size 
+         * of the level data in Lvl and Gmd2 files, to reject zip bombs early
+         * @note By default there is no limit
+         */
+        ImportGmdFile& setMaxInflateRatio(std::optional<size_t> ratio);
         /**
          * Load the file and parse it into a GJGameLevel
          * @returns An Ok Result with the parsed level, or an Err with info
@@ -8,14 +8,8 @@
 
 using namespace geode::prelude;
 using namespace gmd;
+using core::extensionWithoutDot;
 
-static std::string extensionWithoutDot(std::filesystem::path const& path) {
-    auto ext = path.extension().string();
-    if (ext.size()) {
-        return ext.substr(1);
-    }
-    return "";
-}
 static bool verifySongFileName(std::string const& name) {
     // Make sure that the song name is .mp3 and the name is parseable as a number
     if (name.ends_with(".mp3")) {
@@ -28,9 +22,33 @@ static bool verifySongFileName(std::string const& name) {
     return false;
 }
 
+class ImportGmdFile::Impl {
+public:
+    std::optional<size_t> memoryLimit;
+    std::optional<size_t> maxInflateRatio;
+};
+
 ImportGmdFile::ImportGmdFile(
     std::filesystem::path const& path
-) : m_path(path) {}
+) : m_impl(std::make_unique<Impl>()), m_path(path) {}
+
+ImportGmdFile::ImportGmdFile(ImportGmdFile const& other)
+  : IGmdFile(other),
+    m_impl(std::make_unique<Impl>(*other.m_impl)),
+    m_path(other.m_path),
+    m_importSong(other.m_importSong) {}
+ImportGmdFile::ImportGmdFile(ImportGmdFile&& other) noexcept = default;
+ImportGmdFile& ImportGmdFile::operator=(ImportGmdFile const& other) {
+    if (this != &other) {
+        IGmdFile::operator=(other);
+        m_impl = std::make_unique<Impl>(*other.m_impl);
+        m_path = other.m_path;
+        m_importSong = other.m_importSong;
+    }
+    return *this;
+}
+ImportGmdFile& ImportGmdFile::operator=(ImportGmdFile&& other) noexcept = default;
+ImportGmdFile::~ImportGmdFile() {}
 
 bool ImportGmdFile::tryInferType() {
     if (auto ext = gmdTypeFromString(extensionWithoutDot(m_path).c_str())) {
@@ -58,6 +76,25 @@ ImportGmdFile& ImportGmdFile::setImportSong(bool song) {
     return *this;
 }
 
+ImportGmdFile& ImportGmdFile::setMemoryLimit(std::optional<size_t> bytes) {
+    m_impl->memoryLimit = bytes;
+    return *this;
+}
+
+ImportGmdFile& ImportGmdFile::setMaxInflateRatio(std::optional<size_t> ratio) {
+    m_impl->maxInflateRatio = ratio;
+    return *this;
+}
+
+// rough amount of memory DS_Dictionary needs for its DOM relative to the 
+// size of the source text, since it keeps a copy of the text plus nodes
+constexpr size_t DOM_SIZE_FACTOR = 3;
+// room for the xml header normalizePlist may add
+constexpr size_t PLIST_HEADER_SIZE = 128;
+// at its peak, intoLevel holds the level text, the DOM and the level's own 
+// copy of the data
+constexpr size_t PARSE_COST_FACTOR = DOM_SIZE_FACTOR + 1;
+
 geode::Result<std::string> ImportGmdFile::getLevelData() const {
     if (!m_type) {
         return Err(
@@ -65,115 +102,110 @@ geode::Result<std::string> ImportGmdFile::getLevelData() const {
             "file or the developer of the mod forgot to call inferType"
         );
     }
-    switch (m_type.value()) {
-        case GmdFileType::Gmd: {
-            return file::readString(m_path).mapErr([this](std::string err) { return fmt::format("Unable to read {}: {}", m_path, err); });
-        } break;
-    
-        case GmdFileType::Lvl: {
-            GEODE_UNWRAP_INTO(auto data, file::readBinary(m_path));
-            unsigned char* unzippedData;
-            auto count = ZipUtils::ccInflateMemory(
-                data.data(),
-                data.size(),
-                &unzippedData
-            );
-            if (!count) {
-                return Err("Unable to decompress level data");
-            }
-            auto str = std::string(
-                reinterpret_cast<const char*>(unzippedData),
-                count
-            );
-            free(unzippedData);
-            return Ok(str);
-        } break;
-
-        case GmdFileType::Gmd2: {
-            try {
-                GEODE_UNWRAP_INTO(
-                    auto unzip, file::Unzip::create(m_path)
-                        .mapErr([](std::string err) { return fmt::format("Unable to read file: {}", err); })
-                );
-
-                // read metadata
-                GEODE_UNWRAP_INTO(
-                    auto jsonData, unzip.extract("level.meta")
-                        .mapErr([](std::string err) { return fmt::format("Unable to read metadata: {}", err); })
-                );
-
-                GEODE_UNWRAP_INTO(
-                    auto json, matjson::parse(std::string(jsonData.begin(), jsonData.end()))
-                        .mapErr([](std::string err) { return fmt::format("Unable to parse metadata: {}", err); })
-                );
-
-                JsonExpectedValue root(json, "[level.meta]");
-                
-                // unzip song
-                std::string songFile;
-                root.has("song-file").into(songFile);
-                if (m_importSong && songFile.size()) {
-                    // make sure the song file name is legit. without this check 
-                    // it's possible to do arbitary code execution with gmd2
-                    if (!verifySongFileName(songFile)) {
-                        return Err("Song file name '{}' is invalid!", songFile);
-                    }
-
-                    GEODE_UNWRAP_INTO(
-                        auto songData, unzip.extract(songFile)
-                            .mapErr([](std::string err) { return fmt::format("Unable to read song file: {}", err); })
-                    );
-
-                    std::filesystem::path songTargetPath;
-                    if (root.has("song-is-custom").get<bool>()) {
-                        songTargetPath = std::string(MusicDownloadManager::sharedState()->pathForSong(
-                            std::stoi(songFile.substr(0, songFile.find_first_of(".")))
-                        ));
-                    } else {
-                        songTargetPath = "Resources/" + songFile;
-                    }
-
-                    // if we're replacing a file, figure out a different name 
-                    // for the old one
-                    std::filesystem::path oldSongPath = songTargetPath;
-                    while (std::filesystem::exists(oldSongPath)) {
-                        // @geode-ignore(unknown-resource)
-                        oldSongPath.replace_filename(oldSongPath.stem().string() + "_.mp3");
-                    }
-                    if (std::filesystem::exists(oldSongPath)) {
-                        std::filesystem::rename(songTargetPath, oldSongPath);
-                    }
-                    (void)file::writeBinary(songTargetPath, songData);
-                }
-
-                GEODE_UNWRAP_INTO(
-                    auto levelData, unzip.extract("level.data")
-                        .mapErr([](std::string err) { return fmt::format("Unable to read level data: {}", err); })
-                );
-
-                return Ok(std::string(levelData.begin(), levelData.end()));
-            } catch(std::exception& e) {
-                return Err("Unable to read zip: " + std::string(e.what()));
-            }
-        } break;
-
-        default: {
-            return Err("Unknown file type");
-        } break;
+    // the metadata is checked before anything else in the zip is extracted, 
+    // and then only the song file is
+    std::string songFile;
+    bool songIsCustom = false;
+    auto selectSong = [&](std::string_view meta, std::span<core::ExtraEntry> entries) -> core::Result<> {
+        auto json = matjson::parse(meta)
+            .mapErr([](std::string err) { return fmt::format("Unable to parse metadata: {}", err); });
+        if (json.isErr()) {
+            return std::unexpected(json.unwrapErr());
+        }
+        JsonExpectedValue root(json.unwrap(), "[level.meta]");
+        root.has("song-file").into(songFile);
+        root.has("song-is-custom").into(songIsCustom);
+        if (!m_importSong || songFile.empty()) {
+            return {};
+        }
+        // make sure the song file name is legit. without this check 
+        // it's possible to do arbitary code execution with gmd2
+        if (!verifySongFileName(songFile)) {
+            return std::unexpected(fmt::format("Song file name '{}' is invalid!", songFile));
+        }
+        auto song = std::ranges::find(entries, songFile, &core::ExtraEntry::name);
+        if (song == entries.end()) {
+            return std::unexpected(fmt::format("Unable to read song file: Entry '{}' not found", songFile));
+        }
+        song->extract = true;
+        return {};
+    };
+
+    // the zip directory and read buffers of Gmd2 files, freed in one go
+    // when this returns
+    core::ImportArena arena;
+    core::LevelFile level;
+    try {
+        GEODE_UNWRAP_INTO(level, fromCore(core::readLevelFile(m_path, toCoreFormat(m_type.value()), {
+            .memoryLimit = m_impl->memoryLimit,
+            .maxInflateRatio = m_impl->maxInflateRatio,
+            .parseCostFactor = PARSE_COST_FACTOR,
+            .selectExtras = selectSong,
+            .arena = &arena,
+        })));
+    } catch(std::exception& e) {
+        return Err("Unable to read zip: " + std::string(e.what()));
+    }
+    if (level.extras.empty()) {
+        return Ok(std::move(level.data));
     }
+
+    try {
+        std::filesystem::path songTargetPath;
+        if (songIsCustom) {
+            songTargetPath = std::string(MusicDownloadManager::sharedState()->pathForSong(
+                std::stoi(songFile.substr(0, songFile.find_first_of(".")))
+            ));
+        } else {
+            songTargetPath = "Resources/" + songFile;
+        }
+
+        // if we're replacing a file, figure out a different name 
+        // for the old one
+        std::filesystem::path oldSongPath = songTargetPath;
+        while (std::filesystem::exists(oldSongPath)) {
+            // @geode-ignore(unknown-resource)
+            oldSongPath.replace_filename(oldSongPath.stem().string() + "_.mp3");
+        }
+        if (std::filesystem::exists(oldSongPath)) {
+            std::filesystem::rename(songTargetPath, oldSongPath);
+        }
+        (void)file::writeBinary(songTargetPath, level.extras.front().second);
+    } catch(std::exception& e) {
+        return Err("Unable to read zip: " + std::string(e.what()));
+    }
+
+    return Ok(std::move(level.data));
 }
 
 geode::Result<GJGameLevel*> ImportGmdFile::intoLevel() const {
     GEODE_UNWRAP_INTO(auto value, getLevelData());
 
-    auto isOldFile = handlePlistDataForParsing(value);
+    auto budget = core::ImportBudget(m_impl->memoryLimit);
+    GEODE_UNWRAP(fromCore(budget.acquire(value.size(), "reading level data")));
 
+    // reserving space for the header moves the string once
+    GEODE_UNWRAP(fromCore(budget.acquire(value.size() + PLIST_HEADER_SIZE, "normalizing level data")));
+    auto isOldFile = core::normalizePlist(value);
+    budget.release(value.size());
+
+    GEODE_UNWRAP(fromCore(budget.acquire(
+        core::saturatingMul(value.size(), DOM_SIZE_FACTOR), "parsing level data"
+    )));
     auto dict = std::make_unique<DS_Dictionary>();
     if (!dict.get()->loadRootSubDictFromString(value)) {
         return Err("Unable to parse level data");
     }
     dict->stepIntoSubDictWithKey("root");
 
+    // the DOM owns the data now
+    auto valueSize = value.size() + PLIST_HEADER_SIZE;
+    value = std::string();
+    budget.release(valueSize);
+
+    // the level's strings are copied out of the DOM
+    GEODE_UNWRAP(fromCore(budget.acquire(valueSize, "loading the level")));
+
     auto level = GJGameLevel::create();
     level->dataLoaded(dict.get());
 
@@ -229,54 +261,22 @@ geode::Result<ByteVector> ExportGmdFile::intoBytes() const {
             "forgot to set it"
         );
     }
-    switch (m_type.value()) {
-        case GmdFileType::Gmd: {
-            GEODE_UNWRAP_INTO(auto data, this->getLevelData());
-            return Ok(ByteVector(data.begin(), data.end()));
-        } break;
-
-        case GmdFileType::Lvl: {
-            GEODE_UNWRAP_INTO(auto data, this->getLevelData());
-            unsigned char* zippedData = nullptr;
-            auto count = ZipUtils::ccDeflateMemory(
-                reinterpret_cast<unsigned char*>(data.data()),
-                data.size(),
-                &zippedData
-            );
-            if (!count) {
-                return Err("Unable to compress level data");
-            }
-            auto bytes = ByteVector(
-                reinterpret_cast<uint8_t*>(zippedData), 
-                reinterpret_cast<uint8_t*>(zippedData + count)
-            );
-            if (zippedData) {
-                delete[] zippedData;
-            }
-            return Ok(bytes);
-        } break;
-
-        case GmdFileType::Gmd2: {
-            GEODE_UNWRAP_INTO(auto data, this->getLevelData());
-            GEODE_UNWRAP_INTO(auto zip, file::Zip::create());
-
-            auto json = matjson::Value();
-            if (m_includeSong) {
-                auto path = std::filesystem::path(std::string(m_level->getAudioFileName()));
-                json["song-file"] = path.filename().string();
-                json["song-is-custom"] = m_level->m_songID;
-                GEODE_UNWRAP(zip.addFrom(path));
-            }
-            GEODE_UNWRAP(zip.add("level.meta", json.dump()));
-            GEODE_UNWRAP(zip.add("level.data", data));
-
-            return Ok(zip.getData());
-        } break;
-
-        default: {
-            return Err("Unknown file type");
-        } break;
+    GEODE_UNWRAP_INTO(auto data, this->getLevelData());
+    core::LevelFile level { .data = std::move(data) };
+
+    if (m_type.value() == GmdFileType::Gmd2) {
+        auto json = matjson::Value();
+        if (m_includeSong) {
+            auto path = std::filesystem::path(std::string(m_level->getAudioFileName()));
+            json["song-file"] = path.filename().string();
+            json["song-is-custom"] = m_level->m_songID;
+            GEODE_UNWRAP_INTO(auto song, file::readBinary(path));
+            level.extras.emplace_back(path.filename().string(), std::move(song));
+        }
+        level.meta = json.dump();
     }
+
+    return fromCore(core::writeLevelFile(level, toCoreFormat(m_type.value())));
 }
 
 geode::Result<> ExportGmdFile::intoFile(std::filesystem::path const& path) const {
@@ -30,10 +30,8 @@ ImportGmdList& ImportGmdList::setType(GmdListFileType type) {
 }
 
 Result<Ref<GJLevelList>> ImportGmdList::intoList() {
-    GEODE_UNWRAP_INTO(auto data, file::readString(m_impl->path)
-        .mapErr([this](std::string err) { return fmt::format("Unable to read {}: {}", m_impl->path, err); })
-    );
-    handlePlistDataForParsing(data);
+    GEODE_UNWRAP_INTO(auto data, fromCore(core::readListFile(m_impl->path, toCoreFormat(m_impl->type))));
+    core::normalizePlist(data);
 
     auto dict = std::make_unique<DS_Dictionary>();
     if (!dict.get()->loadRootSubDictFromString(data)) {
@@ -74,7 +72,7 @@ geode::Result<geode::ByteVector> ExportGmdList::intoBytes() const {
     auto dict = std::make_unique<DS_Dictionary>();
     m_impl->list->encodeWithCoder(dict.get());
     auto data = std::string(dict->saveRootSubDictToString());
-    return Ok(ByteVector(data.begin(), data.end()));
+    return fromCore(core::writeListFile(data, toCoreFormat(m_impl->type)));
 }
 geode::Result<> ExportGmdList::intoFile(std::filesystem::path const& path) const {
     GEODE_UNWRAP_INTO(auto data, this->intoBytes());
@@ -1,29 +1,19 @@
 #include "Shared.hpp"
 
-static void removeNullbytesFromString(std::string& str) {
-    for (auto& c : str) {
-        if (!c) c = ' ';
+using namespace gmd;
+
+core::LevelFormat toCoreFormat(GmdFileType type) {
+    switch (type) {
+        case GmdFileType::Lvl:  return core::LevelFormat::Lvl;
+        case GmdFileType::Gmd:  return core::LevelFormat::Gmd;
+        case GmdFileType::Gmd2: return core::LevelFormat::Gmd2;
     }
+    return core::LevelFormat::Gmd;
 }
 
-auto ::handlePlistDataForParsing(std::string& value) -> bool {
-    removeNullbytesFromString(value);
-
-    // add gjver if it's missing as otherwise DS_Dictionary fails to load the data
-    auto pos = value.substr(0, 100).find("<plist version=\"1.0\">");
-    if (pos != std::string::npos) {
-        value.replace(pos, 21, "<plist version=\"1.0\" gjver=\"2.0\">");
-    }
-    bool isOldFile = false;
-    if (!value.starts_with("<?xml version")) {
-        if (value.substr(0, 100).find("<plist version") == std::string::npos) {
-            isOldFile = true;
-            value = "<?xml version=\"1.0\"?><plist version=\"1.0\" gjver=\"2.0\"><dict><k>root</k>" +
-                value + "</dict></plist>";
-        }
-        else {
-            value = "<?xml version=\"1.0\"?>" + value;
-        }
+core::ListFormat toCoreFormat(GmdListFileType type) {
+    switch (type) {
+        case GmdListFileType::Gmdl: return core::ListFormat::Gmdl;
     }
-    return isOldFile;
+    return core::ListFormat::Gmdl;
 }
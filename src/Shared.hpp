@@ -1,5 +1,23 @@
 #pragma once
 
-#include <string>
+#include <GMD.hpp>
+#include <GMDCore.hpp>
+#include <Geode/Result.hpp>
 
-bool handlePlistDataForParsing(std::string& str);
+// Glue between the mod's API and the game-independent core
+
+gmd::core::LevelFormat toCoreFormat(gmd::GmdFileType type);
+gmd::core::ListFormat toCoreFormat(gmd::GmdListFileType type);
+
+template <class T>
+geode::Result<T> fromCore(gmd::core::Result<T>&& res) {
+    if (!res) {
+        return geode::Err(std::move(res.error()));
+    }
+    if constexpr (std::is_void_v<T>) {
+        return geode::Ok();
+    }
+    else {
+        return geode::Ok(std::move(*res));
+    }
+}